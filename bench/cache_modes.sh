@@ -0,0 +1,47 @@
+#!/bin/sh
+# Cold-read throughput of fastcat's readers, and how much of the file
+# each leaves in the page cache.
+#
+#   bench/cache_modes.sh BUILD/fastcat FILE [RUNS]
+#
+# Every run starts cold: FILE is evicted with `dd iflag=nocache` first.
+# Lines are numbered (-n) so the reader is used rather than the kernel
+# copy. Needs GNU dd and date, and fincore from util-linux.
+set -eu
+
+bin=$1
+file=$2
+runs=${3:-3}
+
+evict() {
+    dd if="$file" iflag=nocache count=0 status=none
+}
+
+cached() {
+    fincore --bytes --noheadings --output RES "$file" | tr -d ' '
+}
+
+size=$(stat -c %s "$file")
+printf '%-10s %10s %10s %14s\n' mode seconds MB/s cached-after
+
+run() {
+    mode=$1
+    shift
+    best=
+    for _ in $(seq "$runs"); do
+        evict
+        start=$(date +%s%N)
+        env "$@" -n "$file" > /dev/null
+        end=$(date +%s%N)
+        t=$((end - start))
+        if [ -z "$best" ] || [ "$t" -lt "$best" ]; then best=$t; fi
+    done
+    awk -v m="$mode" -v t="$best" -v s="$size" -v c="$(cached)" \
+        'BEGIN { printf "%-10s %10.3f %10.1f %14s\n", m, t / 1e9, s / 1048576 / (t / 1e9), c }'
+}
+
+run buffered FASTCAT_READER=buffered "$bin"
+run mmap FASTCAT_READER=mmap "$bin"
+run async FASTCAT_READER=async "$bin"
+run no-cache "$bin" --no-cache
+evict
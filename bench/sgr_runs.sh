@@ -0,0 +1,56 @@
+#!/bin/sh
+# Bytes written and throughput of highlighted output, with every token
+# wrapped in colour and reset (FASTCAT_SGR=full) against style runs with
+# only the SGR transitions needed.
+#
+#   bench/sgr_runs.sh BUILD/fastcat FILE [SYNTAX] [RUNS]
+#
+# SYNTAX defaults to detection from FILE's name. Each mode is timed
+# writing to /dev/null (the cost of rendering alone) and through a pipe to
+# cat (closer to a pager or terminal, where every byte is copied again);
+# the best of RUNS is shown. The file is read once first so every run
+# finds it in the page cache. Needs GNU date.
+set -eu
+
+bin=$1
+file=$2
+syntax=${3:-}
+runs=${4:-3}
+
+set --
+if [ -n "$syntax" ]; then set -- --syntax "$syntax"; fi
+
+cat "$file" > /dev/null
+size=$(stat -c %s "$file")
+printf '%-8s %14s %8s %10s %10s %10s\n' mode bytes-out ratio seconds MB/s pipe-secs
+
+# Best time of RUNS in ns: CMD...
+best_of() {
+    best=
+    for _ in $(seq "$runs"); do
+        start=$(date +%s%N)
+        "$@"
+        end=$(date +%s%N)
+        t=$((end - start))
+        if [ -z "$best" ] || [ "$t" -lt "$best" ]; then best=$t; fi
+    done
+    echo "$best"
+}
+
+# FASTCAT_SGR, then the fastcat arguments before FILE
+to_null() { sgr=$1; shift; FASTCAT_SGR=$sgr "$bin" "$@" "$file" > /dev/null; }
+to_pipe() { sgr=$1; shift; FASTCAT_SGR=$sgr "$bin" "$@" "$file" | cat > /dev/null; }
+
+run() {
+    mode=$1
+    sgr=$2
+    shift 2
+    t=$(best_of to_null "$sgr" "$@")
+    p=$(best_of to_pipe "$sgr" "$@")
+    out=$(FASTCAT_SGR=$sgr "$bin" "$@" "$file" | wc -c)
+    awk -v m="$mode" -v t="$t" -v p="$p" -v s="$size" -v o="$out" \
+        'BEGIN { printf "%-8s %14d %7.2fx %10.3f %10.1f %10.3f\n", m, o, o / s, t / 1e9, s / 1048576 / (t / 1e9), p / 1e9 }'
+}
+
+run full full "$@"
+run runs minimal "$@"
@@ -1,12 +1,26 @@
 #ifndef FASTCAT_ARGS_H
 #define FASTCAT_ARGS_H
 
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <optional>
 #include <vector>
 
 namespace fastcat {
 
+// --lines START:END, 1-based and inclusive
+struct LineRange {
+    size_t first = 1;
+    size_t last = std::numeric_limits<size_t>::max();
+};
+
+// --bytes OFFSET:LEN
+struct ByteRange {
+    std::uint64_t offset = 0;
+    std::uint64_t length = std::numeric_limits<std::uint64_t>::max();
+};
+
 struct Arguments {
     std::vector<std::string> files;
     std::optional<std::string> syntax;
@@ -18,6 +32,16 @@ struct Arguments {
     bool line_numbers = false;  // Enable line numbers
     bool echo = false;  // Read from stdin (pipeline mode)
     size_t pager_lines = 0;  // Number of lines per page (0 = auto-detect)
+    size_t buffer_size = 0;  // Streaming read buffer in bytes (0 = default)
+    std::optional<LineRange> lines;  // Only print these lines
+    std::optional<ByteRange> bytes;  // Only print this byte window
+    std::optional<size_t> tail;  // Only print the last N lines
+    bool follow = false;  // Keep printing lines appended to the file
+    bool reverse = false;  // Print lines last to first
+    bool show_holes = false;  // Print a marker where a sparse file's hole was skipped
+    bool stats = false;  // Report how each file was read on stderr
+    bool no_cache = false;  // Read without filling the page cache
+    bool recursive = false;  // Read the files under directory arguments
 };
 
 std::optional<Arguments> parse_args(int argc, char* argv[]);
@@ -0,0 +1,83 @@
+#ifndef FASTCAT_BLOCK_PREFETCHER_H
+#define FASTCAT_BLOCK_PREFETCHER_H
+
+#include <memory>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace fastcat {
+
+// Reads a regular file front to back in fixed-size blocks, keeping up to
+// `depth` reads in flight ahead of the consumer so disk I/O overlaps
+// whatever the consumer does with the previous block.
+class BlockPrefetcher {
+public:
+    struct Block {
+        const char* data;
+        std::size_t size;  // 0 at end of file
+        std::uint64_t hole = 0;  // Bytes of file hole skipped just before this block
+    };
+
+    virtual ~BlockPrefetcher() = default;
+
+    // Next block in file order, waiting for its read if necessary. The block
+    // returned by the previous call is recycled for a later read.
+    // Throws std::runtime_error if a read fails.
+    virtual Block next() = 0;
+
+    // Drop everything in flight and continue from `offset`
+    virtual void restart(std::uint64_t offset) = 0;
+
+    // "io_uring" or "pread-thread"
+    virtual const char* backend() const = 0;
+
+    // A position in the data with a known number of newlines before it
+    struct Position {
+        std::uint64_t offset;
+        std::size_t newlines;
+    };
+
+    // For sources that can find line `line` faster than reading up to it:
+    // a position before that line's start (newlines < line, or offset 0),
+    // from which the caller skips forward. std::nullopt if unsupported.
+    virtual std::optional<Position> locate_line(std::size_t line) {
+        (void)line;
+        return std::nullopt;
+    }
+};
+
+// Byte range [offset, end) of a file that holds data
+struct DataExtent {
+    std::uint64_t offset;
+    std::uint64_t end;
+};
+
+// The data extent at or after `offset`, from SEEK_DATA/SEEK_HOLE; anything
+// between `offset` and its start is a hole. Past the last data both ends
+// are the file size. Filesystems that do not report holes give a single
+// extent reaching to UINT64_MAX. Moves fd's file position.
+DataExtent next_data_extent(int fd, std::uint64_t offset);
+
+// How a prefetcher's reads use the page cache
+enum class CachePolicy {
+    Normal,
+    Direct,      // fd is open with O_DIRECT; reads are kept page-aligned
+    DropBehind,  // Each block is evicted (POSIX_FADV_DONTNEED) once consumed
+};
+
+// Prefer io_uring; fall back to a pread worker thread when the kernel (or a
+// seccomp policy) does not allow it, or FASTCAT_IO_URING=0 is set.
+// Reading starts at offset 0. Holes in the file are not read; the block
+// after one reports its size.
+std::unique_ptr<BlockPrefetcher> make_block_prefetcher(
+    int fd,
+    std::uint64_t file_size,
+    std::size_t block_size,
+    std::size_t depth,
+    CachePolicy cache = CachePolicy::Normal
+);
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_BLOCK_PREFETCHER_H
@@ -0,0 +1,62 @@
+#ifndef FASTCAT_CONTENT_SNIFF_H
+#define FASTCAT_CONTENT_SNIFF_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace fastcat {
+
+enum class TextEncoding {
+    Ascii,
+    Utf8,
+    Utf16LE,    // Only recognised by its byte-order mark
+    Utf16BE,
+    Utf32LE,
+    Utf32BE,
+    EightBit,   // High bytes that are not valid UTF-8 (Latin-1 and friends)
+};
+
+enum class LineEnding {
+    None,       // No line break in the sample
+    LF,
+    CRLF,
+    CR,
+    Mixed,
+};
+
+// What the start of a file looks like, from one pass over a sample
+struct ContentInfo {
+    bool sniffed = false;           // False if there was no sample to look at
+    bool binary = false;            // NUL bytes, or too many control bytes
+    TextEncoding encoding = TextEncoding::Ascii;
+    std::size_t bom_length = 0;     // Byte-order mark at the start, 0 if none
+    LineEnding line_ending = LineEnding::None;
+    std::size_t avg_line_length = 0;
+    std::size_t max_line_length = 0;  // Longest line in the sample
+    std::string syntax;             // Probable syntax ("cpp", "python", ...), empty if unsure
+};
+
+// Bytes from the start of a file that are sniffed
+constexpr std::size_t kSniffBytes = 256 * 1024;
+
+// Classify a sample taken from the start of a file
+ContentInfo sniff_content(const char* data, std::size_t len);
+
+// Sniff the first kSniffBytes of fd with pread, up to any hole; the file
+// position is left alone, so this works on a descriptor about to be read.
+// fd may be open with O_DIRECT.
+ContentInfo sniff_file(int fd);
+
+// Sniff a mapping of fd starting at file offset `offset`, cut the same way
+// at the first hole so that its zero pages are neither faulted in nor
+// taken for binary content
+ContentInfo sniff_mapping(const char* data, std::size_t len, int fd, std::uint64_t offset = 0);
+
+// Short names for reports such as --stats ("utf-8", "crlf", ...)
+const char* encoding_name(TextEncoding encoding);
+const char* line_ending_name(LineEnding ending);
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_CONTENT_SNIFF_H
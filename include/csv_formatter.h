@@ -2,6 +2,7 @@
 #define FASTCAT_CSV_FORMATTER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include "file_reader.h"
@@ -27,10 +28,10 @@ struct CsvTable {
 };
 
 // Detect if a line looks like CSV
-bool looks_like_csv(const std::string& line);
+bool looks_like_csv(std::string_view line);
 
 // Parse a single CSV row
-CsvRow parse_csv_row(const std::string& line);
+CsvRow parse_csv_row(std::string_view line);
 
 // Parse CSV file and return formatted table
 // Returns std::nullopt if not valid CSV
@@ -49,10 +50,10 @@ std::string get_rainbow_color(std::size_t col_index);
 std::vector<std::string> format_rainbow_csv_table(const CsvTable& table);
 
 // Detect if a line looks like a markdown table row
-bool looks_like_md_table(const std::string& line);
+bool looks_like_md_table(std::string_view line);
 
 // Check if a line is a markdown table separator (only | - : and spaces)
-bool is_md_table_separator(const std::string& line);
+bool is_md_table_separator(std::string_view line);
 
 // Parse markdown table rows from lines
 // Returns vector of table lines (header, separator, data rows)
@@ -0,0 +1,51 @@
+#ifndef FASTCAT_DECOMPRESS_H
+#define FASTCAT_DECOMPRESS_H
+
+#include "block_prefetcher.h"
+#include <memory>
+#include <string>
+#include <cstddef>
+
+namespace fastcat {
+
+enum class Compression {
+    None,
+    Gzip,
+    Zstd,
+    Xz,
+    Bzip2,
+};
+
+// Identify the format from the leading magic bytes (not the file name)
+Compression detect_compression(int fd);
+Compression detect_compression(const std::string& path);
+
+// "gzip", "zstd", ... or "none"
+const char* compression_name(Compression type);
+
+// False if fastcat was built without the library for `type`
+bool compression_supported(Compression type);
+
+// "app.json.gz" -> "app.json", so the inner extension picks the syntax.
+// Names without a compression suffix are returned unchanged.
+std::string strip_compression_suffix(const std::string& path);
+
+// Decompresses fd front to back on a worker thread into a ring of `depth`
+// blocks of `block_size` bytes, so decoding overlaps whatever the consumer
+// does with the previous block. Concatenated streams (`cat a.gz b.gz`) are
+// decoded as one. restart() decodes again from the start of the file.
+// Multi-frame zstd and BGZF files (see FrameIndex) are instead decoded
+// frame-parallel on all cores, and restart() and locate_line() only decode
+// the frames they need.
+// Throws std::runtime_error if the format is not supported by this build;
+// next() throws if the data is corrupt.
+std::unique_ptr<BlockPrefetcher> make_decompressor(
+    int fd,
+    Compression type,
+    std::size_t block_size,
+    std::size_t depth
+);
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_DECOMPRESS_H
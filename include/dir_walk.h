@@ -0,0 +1,36 @@
+#ifndef FASTCAT_DIR_WALK_H
+#define FASTCAT_DIR_WALK_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace fastcat {
+
+// Directories are read by at least this many threads: a walk waits on the
+// disk (and on inode reads) far more than on the CPU
+constexpr std::size_t kMinWalkThreads = 4;
+
+struct WalkOptions {
+    std::size_t threads = kMinWalkThreads;
+};
+
+// Takes each file a walk finds; returning false stops the walk
+using WalkCallback = std::function<bool(const std::string& path)>;
+
+// Hands the regular files under directory `root` to `found`, read with
+// getdents64 on `threads` threads. The order does not depend on the
+// threads or on the order the filesystem lists entries in: each
+// directory's entries are sorted by name (bytewise) and subdirectories are
+// walked where their name sorts. A file is handed over as soon as every
+// directory before it is listed, so the first files can be printed while
+// the rest of the tree is read; `found` is called from the walk threads,
+// one call at a time. Symbolic links, FIFOs, sockets and devices under
+// root are skipped; a directory that cannot be read is reported on stderr
+// and the walk goes on. Returns once the walk is over. Throws
+// std::runtime_error if root itself cannot be read.
+void walk_tree(const std::string& root, const WalkOptions& options, const WalkCallback& found);
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_DIR_WALK_H
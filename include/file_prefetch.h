@@ -0,0 +1,60 @@
+#ifndef FASTCAT_FILE_PREFETCH_H
+#define FASTCAT_FILE_PREFETCH_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fastcat {
+
+// Files warmed ahead of the one being printed, and the bytes they may hold
+// in the page cache between them
+constexpr std::size_t kPrefetchFiles = 4;
+constexpr std::uint64_t kPrefetchBudget = 64 * 1024 * 1024;
+
+// Warms the files after the one being printed on a background thread, so
+// with many inputs the open and first-read latency of the next file
+// overlaps rendering the current one. Each regular file is opened (pulling
+// in its inode) and its first bytes are requested with
+// POSIX_FADV_WILLNEED; at most `depth` files and `budget` bytes are warmed
+// ahead at a time. Anything else (stdin, FIFOs, devices) is left alone.
+class FilePrefetcher {
+public:
+    explicit FilePrefetcher(std::vector<std::string> paths, std::size_t depth = kPrefetchFiles,
+                            std::uint64_t budget = kPrefetchBudget);
+    ~FilePrefetcher();
+
+    FilePrefetcher(const FilePrefetcher&) = delete;
+    FilePrefetcher& operator=(const FilePrefetcher&) = delete;
+
+    // One more file after the last, found while the first ones print
+    void add(std::string path);
+
+    // paths[index] is about to be printed: its warmed bytes no longer
+    // count against the budget, and files after it may be warmed
+    void advance(std::size_t index);
+
+private:
+    void run();
+
+    std::deque<std::string> paths_;
+    std::deque<std::uint64_t> warmed_;   // Bytes requested per file
+    std::size_t depth_;
+    std::uint64_t budget_;
+    std::size_t current_ = 0;             // File being printed
+    std::size_t next_ = 1;                // Next file to warm
+    std::uint64_t ahead_ = 0;             // Bytes warmed for files after current_
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+};
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_FILE_PREFETCH_H
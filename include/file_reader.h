@@ -1,10 +1,16 @@
 #ifndef FASTCAT_FILE_READER_H
 #define FASTCAT_FILE_READER_H
 
+#include "content_sniff.h"
+#include "reader_strategy.h"
 #include <string>
+#include <string_view>
+#include <span>
 #include <optional>
 #include <variant>
+#include <memory>
 #include <cstddef>
+#include <cstdint>
 
 namespace fastcat {
 
@@ -20,6 +26,7 @@ struct FileInfo {
     std::string path;
     std::uintmax_t size;
     FileSize size_category;
+    ContentInfo content;  // Sniffed when the reader opened the file
 };
 
 // Result of file reading operation
@@ -29,19 +36,111 @@ struct ReadResult {
     bool is_eof;
 };
 
+// Zero-copy view of a line inside the reader's buffer (newline stripped).
+// Valid until the next read, seek or rewind on the reader that produced it.
+struct LineView {
+    std::string_view line;
+    std::size_t line_number;
+    // Non-zero for a marker standing in for this many bytes of file hole
+    // (ReaderOptions::show_holes); line is then empty and line_number that
+    // of the line before the hole
+    std::uint64_t hole = 0;
+};
+
 // Abstract file reader interface
 class IFileReader {
 public:
     virtual ~IFileReader() = default;
-    virtual std::optional<ReadResult> read_line() = 0;
+
+    // Next line as a view; std::nullopt at EOF
+    virtual std::optional<LineView> read_line_view() = 0;
+
+    // Fill `out` with up to out.size() consecutive lines and return how many
+    // were read (0 at EOF). All views in one batch stay valid together until
+    // the next call; readers that recycle their buffer may return short
+    // batches rather than invalidate earlier views.
+    virtual std::size_t read_lines(std::span<LineView> out);
+
+    // Owning variant of read_line_view(), kept for callers that need a copy
+    virtual std::optional<ReadResult> read_line();
+
     virtual bool seek(std::size_t line_number) = 0;
     virtual FileInfo info() const = 0;
     virtual bool is_large() const = 0;
     virtual void rewind() = 0;
 };
 
-// Create appropriate reader based on file size
-std::unique_ptr<IFileReader> create_file_reader(const std::string& path);
+// Stat a path and classify it by size
+FileInfo get_file_info(const std::string& path);
+
+// The same from fstat on an open descriptor, plus a content sniff of
+// regular files. Readers call this once at open and cache the result.
+FileInfo get_file_info(int fd, const std::string& path);
+
+// Tunables for the readers created below
+struct ReaderOptions {
+    std::size_t buffer_size = 0;  // Streaming refill buffer (0 = default 4MB, clamped to 1-8MB)
+    bool show_holes = false;      // Hand out a LineView::hole marker for each skipped hole
+    bool random_access = false;   // Caller will seek or re-read (pager, --lines, CSV)
+    bool no_cache = false;        // Leave the page cache as it was (O_DIRECT or drop-behind)
+    ReaderPlan* plan = nullptr;   // If set, receives the strategy chosen (for --stats)
+};
+
+// Create the reader plan_reader() picks for the file ("-" reads stdin).
+// Holes in sparse files are skipped rather than read as runs of zeros; a
+// line interrupted by a hole is returned as two pieces with one number.
+std::unique_ptr<IFileReader> create_file_reader(const std::string& path, const ReaderOptions& options = {});
+
+// Restrict `reader` to lines [first, last] (1-based, inclusive). It seeks
+// straight to `first` and reports EOF after `last` without reading further;
+// line numbers remain those of the whole file.
+std::unique_ptr<IFileReader> limit_lines(
+    std::unique_ptr<IFileReader> reader, std::size_t first, std::size_t last);
+
+// Reader over bytes [offset, offset + length) of a regular file, mapping
+// only that window; lines cut by either edge are returned as they are.
+// With number_lines the first line is numbered as in the whole file (via
+// the line index), otherwise the window starts at line 1. Throws
+// std::runtime_error for anything but a regular file with a real size.
+std::unique_ptr<IFileReader> create_byte_range_reader(
+    const std::string& path, std::uint64_t offset, std::uint64_t length, bool number_lines,
+    bool show_holes = false);
+
+// Keep only the last `count` lines of `reader`, for inputs such as pipes
+// that cannot be read backwards. Memory is bounded by the lines kept.
+std::unique_ptr<IFileReader> last_lines(std::unique_ptr<IFileReader> reader, std::size_t count);
+
+// Byte range holding the last lines of a regular file
+struct TailRange {
+    std::uint64_t offset = 0;  // Start of the first of the last lines (EOF for none)
+    std::uint64_t end = 0;     // Just past the final newline
+    std::uint64_t size = 0;    // File size less any hole at its end
+};
+
+// Locate the last `lines` lines of a regular file by scanning backwards
+// from EOF, so the cost depends on the lines wanted, not the file size.
+// Holes are skipped, not read.
+// nullopt if the path cannot be opened or is not a regular file.
+std::optional<TailRange> find_tail(const std::string& path, std::size_t lines);
+
+// Reader handing out the lines of bytes [offset, offset + length) of a
+// file last to first, scanning the mapping backwards with O(1) extra
+// memory. "-" reads stdin. Input that is not a regular file with a real
+// size (pipes, devices, procfs files), named or on stdin, is spooled first.
+// With number_lines every line keeps its number from the file. Holes are
+// skipped as by create_file_reader(), with show_holes giving the marker.
+// Throws std::runtime_error if the input cannot be opened.
+std::unique_ptr<IFileReader> create_reverse_reader(
+    const std::string& path, std::uint64_t offset, std::uint64_t length, bool number_lines,
+    bool show_holes = false);
+
+// In-memory budget before spool_input() spills to disk
+constexpr std::size_t kDefaultSpoolMemory = 64 * 1024 * 1024;
+
+// Read all of fd (typically stdin) into a rewindable reader, for modes that
+// must see the whole input before printing. Data stays in memory up to
+// `memory_limit` bytes and spills to an unlinked file in $TMPDIR beyond it.
+std::unique_ptr<IFileReader> spool_input(int fd, std::size_t memory_limit = kDefaultSpoolMemory);
 
 }  // namespace fastcat
 
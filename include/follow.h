@@ -0,0 +1,52 @@
+#ifndef FASTCAT_FOLLOW_H
+#define FASTCAT_FOLLOW_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fastcat {
+
+// Streams lines appended to a file, like `tail -f`.
+// Blocks on inotify rather than polling. A file that shrinks is taken to
+// have been truncated and is read again from the start; when the path is
+// renamed or deleted (log rotation), whatever is left of the old file is
+// read first, then the follower switches to the new file at that path as
+// soon as it appears.
+class FileFollower {
+public:
+    // Start reading `path` at byte `offset`. Throws std::runtime_error if
+    // the file cannot be opened or watched.
+    FileFollower(const std::string& path, std::uint64_t offset);
+    ~FileFollower();
+
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator=(const FileFollower&) = delete;
+
+    // Wait until at least one complete line is available and replace the
+    // contents of `lines` with those that are, a read chunk's worth at a
+    // time; lines left over are returned by the next call without waiting.
+    // A line is only returned once its newline has been written. Returns
+    // false if following failed.
+    bool wait(std::vector<std::string>& lines);
+
+private:
+    bool open_file();
+    void read_available(std::vector<std::string>& lines);
+    bool switch_file(std::vector<std::string>& lines);
+    bool read_events();
+
+    std::string path_;
+    std::string name_;          // Last path component, matched against directory events
+    int fd_ = -1;
+    int inotify_ = -1;
+    int file_watch_ = -1;
+    int dir_watch_ = -1;
+    std::uint64_t offset_;
+    std::string carry_;         // Start of a line whose newline has not arrived yet
+    bool replaced_ = false;     // Path may no longer refer to the open file
+};
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_FOLLOW_H
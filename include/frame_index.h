@@ -0,0 +1,62 @@
+#ifndef FASTCAT_FRAME_INDEX_H
+#define FASTCAT_FRAME_INDEX_H
+
+#include "decompress.h"
+#include "line_index.h"
+#include <optional>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace fastcat {
+
+// Layout of a compressed file made of independent frames: multi-frame zstd
+// (zstd -B, pzstd, seekable zstd) or BGZF (bgzip, htslib). Every frame can
+// be decoded on its own, so frames are decoded in parallel and a seek only
+// decodes the frames it lands in. The index is built from frame headers
+// alone; newline counts per frame are filled in as frames get decoded.
+class FrameIndex {
+public:
+    struct Frame {
+        std::uint64_t offset;      // Start in the compressed file
+        std::uint64_t size;        // Compressed bytes
+        std::uint64_t raw_offset;  // Start in the decompressed stream
+        std::uint64_t raw_size;    // Decompressed bytes
+    };
+
+    // Walk the frame headers of fd. std::nullopt unless the file is a
+    // sequence of at least two frames whose decompressed sizes are recorded
+    // in their headers (plain gzip and single-frame zstd stream instead).
+    static std::optional<FrameIndex> scan(int fd, Compression type);
+
+    const std::vector<Frame>& frames() const { return frames_; }
+    std::uint64_t raw_size() const;
+
+    // Frame containing decompressed byte `raw_offset` (last frame if past the end)
+    std::size_t find(std::uint64_t raw_offset) const;
+
+    // Newlines in frames [0, counted()) are known
+    std::size_t counted() const { return newlines_before_.size() - 1; }
+
+    // Newlines in all frames before frame k, for k <= counted()
+    std::size_t newlines_before(std::size_t k) const { return newlines_before_[k]; }
+
+    // Record the newline count of frame counted()
+    void add_count(std::size_t newlines);
+
+    // Last frame, among those counted, with fewer than `line` newlines
+    // before it; frame 0 if none
+    std::size_t frame_for_line(std::size_t line) const;
+
+    // Persistent cache next to the line index cache (same keying rules)
+    static std::optional<FrameIndex> load_cached(const FileKey& key);
+    bool store_cached(const FileKey& key) const;
+
+private:
+    std::vector<Frame> frames_;
+    std::vector<std::size_t> newlines_before_{0};  // Prefix sums, one more than counted
+};
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_FRAME_INDEX_H
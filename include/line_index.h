@@ -0,0 +1,81 @@
+#ifndef FASTCAT_LINE_INDEX_H
+#define FASTCAT_LINE_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace fastcat {
+
+// Identity of a file's contents for cache lookups
+struct FileKey {
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+};
+
+// Stat an open descriptor; std::nullopt for non-regular files
+std::optional<FileKey> file_key(int fd);
+
+// Sparse line-offset index: the start offset of every `stride`-th line.
+// It is built incrementally as a reader scans forward, so seeking to line N
+// only ever scans up to N once; later seeks (and later runs, through the
+// on-disk cache) jump to the nearest checkpoint and skip < stride lines.
+class LineIndex {
+public:
+    static constexpr std::size_t kDefaultStride = 1024;
+
+    // A line whose start offset is known
+    struct Checkpoint {
+        std::size_t line;      // Lines before it (0 = first line)
+        std::uint64_t offset;  // Byte offset of its first character
+    };
+
+    // Supplies file bytes starting at `offset`; an empty view means EOF
+    using ChunkSource = std::function<std::string_view(std::uint64_t offset)>;
+
+    explicit LineIndex(std::size_t stride = kDefaultStride);
+
+    // Closest checkpoint at or before `line`
+    Checkpoint lookup(std::size_t line) const;
+
+    // Closest checkpoint at or before byte `offset`
+    Checkpoint lookup_offset(std::uint64_t offset) const;
+
+    // Feed the bytes immediately following scanned_bytes()
+    void extend(const char* data, std::size_t len);
+
+    // Scan forward through `source` until `line` is covered or EOF.
+    // Returns true if the index grew.
+    bool cover(std::size_t line, const ChunkSource& source);
+
+    // Same, until byte `offset` is covered
+    bool cover_offset(std::uint64_t offset, const ChunkSource& source);
+
+    std::uint64_t scanned_bytes() const { return scanned_bytes_; }
+    std::size_t scanned_lines() const { return scanned_lines_; }
+    bool complete() const { return complete_; }
+
+    // Persistent cache under $XDG_CACHE_HOME/fastcat (or ~/.cache/fastcat).
+    // Entries are keyed by device/inode and discarded when size or mtime
+    // no longer match. Failures are silent; the cache is best effort.
+    static std::optional<LineIndex> load_cached(const FileKey& key);
+    bool store_cached(const FileKey& key) const;
+
+private:
+    std::size_t stride_;
+    std::vector<std::uint64_t> offsets_;  // offsets_[k] = start of line k * stride_
+    std::uint64_t scanned_bytes_;
+    std::size_t scanned_lines_;           // Newlines seen so far
+    std::size_t pending_lines_;           // Newlines since the last checkpoint
+    bool complete_;
+};
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_LINE_INDEX_H
@@ -0,0 +1,52 @@
+#ifndef FASTCAT_LINE_SCAN_H
+#define FASTCAT_LINE_SCAN_H
+
+#include <cstddef>
+
+namespace fastcat {
+
+// Newline scanning kernel shared by the readers.
+// The implementation (AVX-512BW, AVX2, SSE2 or portable scalar) is picked
+// once at runtime from CPUID; every variant returns identical results.
+// Setting FASTCAT_SIMD=scalar|sse2|avx2|avx512 forces a lower variant.
+
+// Offset of the first '\n' in [data, data + len), or len if there is none
+std::size_t find_newline(const char* data, std::size_t len);
+
+// Store offsets of up to `max` newlines into `out`; returns how many
+std::size_t find_newlines(const char* data, std::size_t len, std::size_t* out, std::size_t max);
+
+// Number of '\n' bytes in [data, data + len)
+std::size_t count_newlines(const char* data, std::size_t len);
+
+// Step over up to `lines` newlines. Returns the offset just past the last
+// newline consumed if all `lines` were found (leaving `lines` at 0), or len
+// with `lines` reduced by the number seen if the buffer ran out first.
+std::size_t skip_lines(const char* data, std::size_t len, std::size_t& lines);
+
+// skip_lines() walking backwards from the end. Returns the offset just past
+// the lines-th newline counted from the end (leaving `lines` at 0), or 0
+// with `lines` reduced by the number seen if the buffer ran out first.
+std::size_t rskip_lines(const char* data, std::size_t len, std::size_t& lines);
+
+// Byte class counts of a buffer, gathered in one pass
+struct ByteStats {
+    std::size_t newlines = 0;   // '\n'
+    std::size_t crlf = 0;       // "\r\n" pairs
+    std::size_t lone_cr = 0;    // '\r' not followed by '\n'
+    std::size_t nul = 0;        // '\0'
+    std::size_t control = 0;    // Other bytes below 0x20 except '\t', '\f' and ESC
+    std::size_t high = 0;       // Bytes >= 0x80
+    std::size_t max_line = 0;   // Longest line, newline excluded
+};
+
+// ByteStats of [data, data + len); a final line without a newline counts
+// towards max_line
+ByteStats byte_stats(const char* data, std::size_t len);
+
+// Name of the selected implementation, e.g. "avx2"
+const char* line_scan_isa();
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_LINE_SCAN_H
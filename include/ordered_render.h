@@ -0,0 +1,126 @@
+#ifndef FASTCAT_ORDERED_RENDER_H
+#define FASTCAT_ORDERED_RENDER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fastcat {
+
+// Jobs a worker may render ahead of the one being written, and the
+// finished output they may hold in memory between them
+constexpr std::size_t kRenderAheadPerThread = 2;
+constexpr std::uint64_t kRenderBudget = 256 * 1024 * 1024;
+
+// Upper bound on render threads, whatever the core count
+constexpr std::size_t kMaxRenderThreads = 64;
+
+// Threads to render with: one per core, or FASTCAT_THREADS
+std::size_t render_threads();
+
+// Renders jobs 0..count-1 on a pool of threads, each into its own buffer,
+// and hands the buffers back in job order, so output written as it is
+// taken is the same as rendering one job after another. Jobs start in
+// order; no more than `ahead` beyond the one being taken are started, and
+// none while finished, untaken output exceeds `budget`.
+class OrderedRenderPool {
+public:
+    // Render job `index` into `out`. Returning false leaves the job to the
+    // caller (e.g. too large to hold in memory); an exception is handed
+    // back by take() with whatever was rendered before it.
+    using RenderFn = std::function<bool(std::size_t index, std::string& out)>;
+
+    struct Result {
+        bool rendered = false;
+        std::string output;
+        std::exception_ptr error;
+    };
+
+    OrderedRenderPool(std::size_t count, std::size_t threads, RenderFn render,
+                      std::size_t ahead, std::uint64_t budget = kRenderBudget);
+    ~OrderedRenderPool();
+
+    OrderedRenderPool(const OrderedRenderPool&) = delete;
+    OrderedRenderPool& operator=(const OrderedRenderPool&) = delete;
+
+    // Raise the job count to `count`, for jobs found while earlier ones
+    // render (files of a directory walk)
+    void extend(std::size_t count);
+
+    // Wait for job `index` and take its result; called for 0, 1, 2, ...
+    // below the job count
+    Result take(std::size_t index);
+
+private:
+    void run();
+
+    std::size_t count_ = 0;
+    std::size_t threads_;         // Started as there are jobs for them
+    RenderFn render_;
+    std::size_t ahead_;
+    std::uint64_t budget_;
+    std::deque<std::optional<Result>> results_;
+    std::size_t next_ = 0;        // Next job to start
+    std::size_t taken_ = 0;       // Next job to be taken
+    std::uint64_t buffered_ = 0;  // Bytes of finished jobs not yet taken
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::vector<std::thread> workers_;
+};
+
+// Runs tasks on a pool of threads as they are submitted and hands their
+// output back in submission order. The caller bounds the work in flight
+// by taking output once pending() reaches its limit.
+class OrderedTaskQueue {
+public:
+    using Task = std::function<void(std::string& out)>;
+
+    explicit OrderedTaskQueue(std::size_t threads);
+    ~OrderedTaskQueue();
+
+    OrderedTaskQueue(const OrderedTaskQueue&) = delete;
+    OrderedTaskQueue& operator=(const OrderedTaskQueue&) = delete;
+
+    void submit(Task task);
+
+    // Tasks submitted and not yet taken
+    std::size_t pending() const;
+
+    // Wait for the oldest pending task and take its output; rethrows what
+    // the task threw
+    std::string take();
+
+private:
+    struct Slot {
+        Task task;
+        std::string output;
+        std::exception_ptr error;
+        bool done = false;
+    };
+
+    void run();
+
+    // Pending tasks, oldest first. Workers keep references into it while
+    // running a task; only finished slots are popped.
+    std::deque<Slot> slots_;
+    std::size_t started_ = 0;   // Slots from the front already handed to a worker
+    bool stop_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_ORDERED_RENDER_H
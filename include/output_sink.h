@@ -0,0 +1,96 @@
+#ifndef FASTCAT_OUTPUT_SINK_H
+#define FASTCAT_OUTPUT_SINK_H
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+
+namespace fastcat {
+
+// Sink buffer sizes by destination. Pipes get their own capacity
+// (F_GETPIPE_SZ), so each write fills the pipe once.
+constexpr std::size_t kFileSinkBuffer = 1024 * 1024;
+constexpr std::size_t kTerminalSinkBuffer = 16 * 1024;
+constexpr std::size_t kDefaultSinkBuffer = 64 * 1024;
+
+// Where rendered output goes, instead of std::cout: one contiguous buffer
+// drained with write(2), or writev(2) when a block too large to buffer
+// follows buffered output. An in-memory sink collects the output in a
+// string instead, for render threads whose output is written later.
+// Nothing is written until the buffer fills or flush() is called.
+// Write errors throw std::runtime_error (EPIPE only if SIGPIPE is ignored).
+class OutputSink {
+public:
+    // Buffer sized to what fd is (file, pipe, terminal)
+    explicit OutputSink(int fd);
+    // Appends to target
+    explicit OutputSink(std::string& target);
+    // Flushes what is left; errors are dropped
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    void write(const char* data, std::size_t len) {
+        if (len <= capacity_ - used_) {
+            std::memcpy(buffer_.get() + used_, data, len);
+            used_ += len;
+            return;
+        }
+        write_slow(data, len);
+    }
+
+    void write(std::string_view text) { write(text.data(), text.size()); }
+
+    void put(char c) {
+        if (used_ == capacity_) drain(nullptr, 0);
+        buffer_[used_++] = c;
+    }
+
+    // Gather write: the pieces in order. A batch larger than the buffer
+    // goes out with writev(2) straight from the pieces, after what is
+    // buffered, without being copied.
+    void write(std::span<const struct iovec> pieces);
+
+    // Each line followed by '\n'
+    void write_lines(std::span<const std::string_view> lines);
+    void write_lines(std::span<const std::string> lines);
+
+    OutputSink& operator<<(std::string_view text) {
+        write(text);
+        return *this;
+    }
+
+    OutputSink& operator<<(char c) {
+        put(c);
+        return *this;
+    }
+
+    // Write out everything buffered
+    void flush() {
+        if (used_) drain(nullptr, 0);
+    }
+
+    // The descriptor written to; -1 for an in-memory sink
+    int fd() const { return fd_; }
+
+private:
+    void write_slow(const char* data, std::size_t len);
+    // Write the buffer, then `len` bytes of data, and empty the buffer
+    void drain(const char* data, std::size_t len);
+    void write_all(struct iovec* iov, std::size_t count);
+
+    int fd_ = -1;
+    std::string* target_ = nullptr;
+    std::unique_ptr<char[]> buffer_;
+    std::size_t capacity_ = kDefaultSinkBuffer;
+    std::size_t used_ = 0;
+};
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_OUTPUT_SINK_H
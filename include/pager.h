@@ -1,8 +1,11 @@
 #ifndef FASTCAT_PAGER_H
 #define FASTCAT_PAGER_H
 
+#include "output_sink.h"
+#include <cstdint>
+#include <span>
 #include <string>
-#include <functional>
+#include <string_view>
 
 namespace fastcat {
 
@@ -13,9 +16,6 @@ enum class PagerMode {
     Auto,       // Auto-detect based on file size/terminal
 };
 
-// Output callback for pager
-using OutputCallback = std::function<void(const std::string&)>;
-
 // Get terminal size
 struct TerminalSize {
     std::size_t rows;
@@ -31,26 +31,32 @@ bool should_use_pager(PagerMode mode, std::uintmax_t file_size, bool is_tty);
 class Pager {
 public:
     Pager(
-        OutputCallback output,
+        OutputSink& sink,
         std::size_t page_lines = 0,
         bool line_numbers = false
     );
 
-    void output(const std::string& text);
-    void output_line(const std::string& line);
-    void output_line_number(const std::string& line, std::size_t line_num);
+    void output(std::string_view text);
+    void output_line(std::string_view line);
+    void output_line_number(std::string_view line, std::size_t line_num);
+    // Many lines in one call: each page's worth goes to the sink at once,
+    // with the pause between pages as for output_line()
+    void output_lines(std::span<const std::string_view> lines);
+    void output_lines(std::span<const std::string> lines);
     void flush();
     void finalize();
 
     std::size_t lines_output() const { return lines_output_; }
 
 private:
-    OutputCallback output_;
+    OutputSink& sink_;
     std::size_t page_lines_;
     bool line_numbers_;
     std::size_t lines_output_;
     std::size_t lines_since_pause_;
 
+    template <typename Line>
+    void output_batch(std::span<const Line> lines);
     void maybe_pause();
     void wait_for_input();
 };
@@ -0,0 +1,20 @@
+#ifndef FASTCAT_PASSTHROUGH_H
+#define FASTCAT_PASSTHROUGH_H
+
+#include <string>
+
+namespace fastcat {
+
+// Copy a file to out_fd without splitting it into lines.
+// Bytes are moved kernel-side where possible (copy_file_range to regular
+// files, splice to pipes, sendfile otherwise) and through a large
+// read/write buffer when not. Like the line-based path, a final newline is
+// appended if the input does not end with one.
+// Returns false if the input cannot be handled this way (cannot be opened,
+// is a directory, ...) so the caller can fall back to the regular reader.
+// Throws std::runtime_error if writing fails part-way through.
+bool copy_file_raw(const std::string& path, int out_fd);
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_PASSTHROUGH_H
@@ -0,0 +1,58 @@
+#ifndef FASTCAT_READER_STRATEGY_H
+#define FASTCAT_READER_STRATEGY_H
+
+#include <cstdint>
+
+namespace fastcat {
+
+// How create_file_reader() reads a file
+enum class ReaderStrategy {
+    Mmap,           // Map the whole file; line views point into the mapping
+    WindowedMmap,   // Map a window at the current line and slide it forward
+    Buffered,       // read() into one reused buffer
+    Async,          // Read-ahead on io_uring or a reader thread
+    Decompress,     // Decoded on a worker thread
+};
+
+// What fstat (and statfs) say the input is
+enum class FileKind {
+    Regular,
+    Virtual,      // procfs/sysfs: size reported as 0 or a page, content generated on read
+    Pipe,
+    Socket,
+    CharDevice,
+    BlockDevice,
+    Other,
+};
+
+// The strategy chosen for one input and what it was chosen from
+struct ReaderPlan {
+    ReaderStrategy strategy = ReaderStrategy::Buffered;
+    const char* reason = "";            // Short explanation, for --stats
+    FileKind kind = FileKind::Other;
+    std::uint64_t size = 0;             // Block devices are sized by ioctl; 0 if unknown
+    int resident_percent = -1;          // Sampled share of the file in the page cache, -1 if not checked
+    std::uint64_t available_memory = 0; // MemAvailable when the plan was made, 0 if not checked
+};
+
+// Choose a reader for the open descriptor fd. random_access tells that
+// the caller will seek or read the file more than once (pager, --lines,
+// CSV tables), which favours a mapping: of the whole file when it fits
+// in memory, else of a sliding window. FASTCAT_READER=mmap|window|
+// buffered|async overrides the choice for regular files.
+// Compression is not detected here.
+ReaderPlan plan_reader(int fd, bool random_access);
+
+// fd is on procfs or sysfs, whose files report a size of 0 or one page
+// whatever they hold
+bool is_virtual_fs(int fd);
+
+// Memory the kernel reports as available without swapping, 0 if unknown
+std::uint64_t available_memory();
+
+const char* strategy_name(ReaderStrategy strategy);
+const char* file_kind_name(FileKind kind);
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_READER_STRATEGY_H
@@ -0,0 +1,29 @@
+#ifndef FASTCAT_STYLE_RUNS_H
+#define FASTCAT_STYLE_RUNS_H
+
+#include "syntax_highlight.h"
+#include <string>
+#include <vector>
+
+namespace fastcat {
+
+// Append highlighted tokens to `out` as style runs: the terminal style is
+// tracked across tokens, including SGR sequences inside token text (the
+// keyword colouring of highlight_cpp), and only the transitions between
+// runs that differ are written, each as one SGR sequence, the shorter of
+// an incremental change and a reset. Blanks are written in whatever style
+// is current unless an underline or unknown attribute (background) would
+// show. The line always ends in the default style, so it looks the same
+// as with append_styled_full() in fewer bytes.
+void append_styled(const std::vector<SyntaxToken>& tokens, std::string& out);
+
+// Colour, bold, text and reset for every token
+void append_styled_full(const std::vector<SyntaxToken>& tokens, std::string& out);
+
+// False when FASTCAT_SGR=full asks for append_styled_full(), for
+// comparisons (bench/sgr_runs.sh)
+bool minimal_sgr();
+
+}  // namespace fastcat
+
+#endif  // FASTCAT_STYLE_RUNS_H
@@ -2,9 +2,65 @@
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include <cstdlib>
 
 namespace fastcat {
 
+// Parse a byte count with an optional K/M/G suffix ("4M", "512K", "1048576")
+static std::optional<size_t> parse_size(const char* text) {
+    char* end = nullptr;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) return std::nullopt;
+
+    switch (*end) {
+        case 'k': case 'K': value <<= 10; ++end; break;
+        case 'm': case 'M': value <<= 20; ++end; break;
+        case 'g': case 'G': value <<= 30; ++end; break;
+        default: break;
+    }
+    if (*end != '\0') return std::nullopt;
+    return static_cast<size_t>(value);
+}
+
+// Parse "START:END", "START:", ":END" or "N" (a single line)
+static std::optional<LineRange> parse_line_range(const char* text) {
+    LineRange range;
+    const char* colon = strchr(text, ':');
+    std::string first(text, colon ? colon - text : strlen(text));
+
+    if (!first.empty()) {
+        auto value = parse_size(first.c_str());
+        if (!value || *value == 0) return std::nullopt;
+        range.first = *value;
+    }
+    if (!colon) {
+        if (first.empty()) return std::nullopt;
+        range.last = range.first;
+    } else if (colon[1] != '\0') {
+        auto value = parse_size(colon + 1);
+        if (!value || *value < range.first) return std::nullopt;
+        range.last = *value;
+    }
+    return range;
+}
+
+// Parse "OFFSET:LEN" or "OFFSET" (to end of file); both take K/M/G suffixes
+static std::optional<ByteRange> parse_byte_range(const char* text) {
+    ByteRange range;
+    const char* colon = strchr(text, ':');
+    std::string offset(text, colon ? colon - text : strlen(text));
+
+    auto value = parse_size(offset.c_str());
+    if (!value) return std::nullopt;
+    range.offset = *value;
+    if (colon && colon[1] != '\0') {
+        auto length = parse_size(colon + 1);
+        if (!length) return std::nullopt;
+        range.length = *length;
+    }
+    return range;
+}
+
 std::optional<Arguments> parse_args(int argc, char* argv[]) {
     Arguments args;
 
@@ -65,6 +121,89 @@ std::optional<Arguments> parse_args(int argc, char* argv[]) {
             continue;
         }
 
+        if (strcmp(arg, "--buffer-size") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --buffer-size requires a value\n";
+                return std::nullopt;
+            }
+            auto size = parse_size(argv[++i]);
+            if (!size) {
+                std::cerr << "Error: Invalid --buffer-size: " << argv[i] << "\n";
+                return std::nullopt;
+            }
+            args.buffer_size = *size;
+            continue;
+        }
+
+        if (strcmp(arg, "--lines") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --lines requires a value\n";
+                return std::nullopt;
+            }
+            args.lines = parse_line_range(argv[++i]);
+            if (!args.lines) {
+                std::cerr << "Error: Invalid --lines: " << argv[i] << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (strcmp(arg, "--bytes") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --bytes requires a value\n";
+                return std::nullopt;
+            }
+            args.bytes = parse_byte_range(argv[++i]);
+            if (!args.bytes) {
+                std::cerr << "Error: Invalid --bytes: " << argv[i] << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (strcmp(arg, "--tail") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --tail requires a value\n";
+                return std::nullopt;
+            }
+            args.tail = parse_size(argv[++i]);
+            if (!args.tail) {
+                std::cerr << "Error: Invalid --tail: " << argv[i] << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (strcmp(arg, "--follow") == 0 || strcmp(arg, "-f") == 0) {
+            args.follow = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--reverse") == 0) {
+            args.reverse = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--show-holes") == 0) {
+            args.show_holes = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--stats") == 0) {
+            args.stats = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--no-cache") == 0) {
+            args.no_cache = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--recursive") == 0 || strcmp(arg, "-r") == 0) {
+            args.recursive = true;
+            continue;
+        }
+
         // Treat as file name
         if (arg[0] != '-') {
             args.files.push_back(arg);
@@ -75,6 +214,26 @@ std::optional<Arguments> parse_args(int argc, char* argv[]) {
         return std::nullopt;
     }
 
+    if ((args.lines ? 1 : 0) + (args.bytes ? 1 : 0) + (args.tail ? 1 : 0) > 1) {
+        std::cerr << "Error: Only one of --lines, --bytes and --tail can be used\n";
+        return std::nullopt;
+    }
+
+    if (args.follow && (args.lines || args.bytes || args.echo || args.files.size() != 1)) {
+        std::cerr << "Error: --follow needs a single file and cannot be combined with --lines or --bytes\n";
+        return std::nullopt;
+    }
+
+    if (args.follow && args.recursive) {
+        std::cerr << "Error: --follow cannot be combined with --recursive\n";
+        return std::nullopt;
+    }
+
+    if (args.reverse && (args.lines || args.follow)) {
+        std::cerr << "Error: --reverse cannot be combined with --lines or --follow\n";
+        return std::nullopt;
+    }
+
     // If no files specified, read from stdin
     if (args.files.empty()) {
         args.files.push_back("-");
@@ -95,6 +254,16 @@ void print_usage(const char* program_name) {
               << "  --pager, -p         Use pager for output (less-like mode)\n"
               << "  --no-pager          Never use pager\n"
               << "  --linenumber, -n    Show line numbers\n"
+              << "  --buffer-size <n>   Read buffer for large files, e.g. 8M (1M-8M, default 4M)\n"
+              << "  --lines <s:e>       Only show lines s through e (1-based; s:, :e or n)\n"
+              << "  --bytes <off:len>   Only show len bytes from off (e.g. 1G:4M; len optional)\n"
+              << "  --tail <n>          Only show the last n lines\n"
+              << "  --follow, -f        Keep showing lines as they are appended\n"
+              << "  --reverse           Show lines last to first (like tac)\n"
+              << "  --show-holes        Mark skipped holes in sparse files, e.g. [hole: 4.0 GiB]\n"
+              << "  --stats             Report how each file was read (reader, cache, content) on stderr\n"
+              << "  --no-cache          Read with O_DIRECT (or drop pages behind) to spare the page cache\n"
+              << "  --recursive, -r     Read the text files under each directory, in name order\n"
               << "  -e                  Read from stdin (pipeline mode)\n\n"
               << "Examples:\n"
               << "  " << program_name << " file.txt\n"
@@ -102,6 +271,9 @@ void print_usage(const char* program_name) {
               << "  " << program_name << " --align-csv data.csv\n"
               << "  " << program_name << " --rainbowcsv data.csv\n"
               << "  " << program_name << " -n file.txt\n"
+              << "  " << program_name << " -n --lines 5000000:5000100 huge.log\n"
+              << "  " << program_name << " --tail 20 -f app.log\n"
+              << "  " << program_name << " --reverse -n app.log\n"
               << "  echo 'code' | " << program_name << " -e --syntax cpp\n";
 }
 
@@ -0,0 +1,435 @@
+#include "block_prefetcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+constexpr std::size_t kBlockAlign = 4096;
+
+enum class SlotState {
+    Idle,      // Nothing scheduled (past end of file)
+    InFlight,  // Read submitted
+    Ready,     // Read finished, result is valid
+};
+
+struct Slot {
+    char* data = nullptr;
+    std::uint64_t offset = 0;
+    std::size_t expected = 0;  // Bytes the read should return (iov_len may be rounded up)
+    std::uint64_t hole = 0;    // Hole skipped just before offset
+    ssize_t result = 0;        // Bytes read, or -errno
+    int error = 0;
+    SlotState state = SlotState::Idle;
+    struct iovec iov{};
+};
+
+// In-order ring of read slots; backends only start reads and wait for them
+class SlotPrefetcher : public BlockPrefetcher {
+public:
+    SlotPrefetcher(int fd, std::uint64_t file_size, std::size_t block_size, std::size_t depth,
+                   CachePolicy cache)
+        : fd_(fd), slots_(std::max<std::size_t>(depth, 2)), file_size_(file_size), block_size_(block_size),
+          cache_(cache) {
+        for (auto& slot : slots_) {
+            slot.data = static_cast<char*>(std::aligned_alloc(kBlockAlign, block_size_));
+            if (!slot.data) throw std::bad_alloc();
+            slot.iov.iov_base = slot.data;
+        }
+    }
+
+    ~SlotPrefetcher() override {
+        for (auto& slot : slots_) std::free(slot.data);
+    }
+
+    Block next() override {
+        // The block handed out last time is free again
+        if (handed_out_) {
+            Slot& done = slots_[(head_ + slots_.size() - 1) % slots_.size()];
+            if (cache_ == CachePolicy::DropBehind && done.state == SlotState::Ready) {
+                posix_fadvise(fd_, static_cast<off_t>(done.offset), static_cast<off_t>(done.expected),
+                              POSIX_FADV_DONTNEED);
+            }
+            schedule(done);
+        }
+        handed_out_ = true;
+
+        Slot& slot = slots_[head_];
+        if (slot.state == SlotState::Idle) {
+            // A hole running to the end of the file is reported once
+            return Block{nullptr, 0, std::exchange(pending_hole_, 0)};
+        }
+        wait(slot);
+
+        if (slot.error != 0) {
+            throw std::runtime_error(std::string("read failed: ") + std::strerror(slot.error));
+        }
+        // Short reads are rare on regular files; finish the block inline
+        // (an O_DIRECT read rounded up past EOF returns more than expected)
+        std::size_t got = std::min(static_cast<std::size_t>(slot.result), slot.expected);
+        while (got < slot.expected) {
+            ssize_t n = pread(fd_, slot.data + got, slot.expected - got,
+                              static_cast<off_t>(slot.offset + got));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;  // File shrank
+            got += static_cast<std::size_t>(n);
+        }
+
+        head_ = (head_ + 1) % slots_.size();
+        // After an unaligned restart in Direct mode, the first block starts
+        // at the aligned offset below the one asked for
+        std::size_t lead = std::min(std::exchange(lead_, 0), got);
+        return Block{slot.data + lead, got - lead, slot.hole};
+    }
+
+    void restart(std::uint64_t offset) override {
+        drain();
+        for (auto& slot : slots_) slot.state = SlotState::Idle;
+        head_ = 0;
+        handed_out_ = false;
+        lead_ = 0;
+        if (cache_ == CachePolicy::Direct) {
+            lead_ = static_cast<std::size_t>(offset % kBlockAlign);
+            offset -= lead_;
+        }
+        next_offset_ = offset;
+        data_end_ = offset;
+        pending_hole_ = 0;
+        for (auto& slot : slots_) schedule(slot);
+    }
+
+protected:
+    // Start reading slot.iov at slot.offset
+    virtual void submit(Slot& slot) = 0;
+    // Block until slot.state == Ready
+    virtual void wait(Slot& slot) = 0;
+    // Block until no read is in flight
+    virtual void drain() = 0;
+
+    int fd_;
+    std::vector<Slot> slots_;
+
+private:
+    void schedule(Slot& slot) {
+        if (next_offset_ >= data_end_ && next_offset_ < file_size_) {
+            // Leaving a data extent: jump over the hole after it, if any
+            DataExtent extent = next_data_extent(fd_, next_offset_);
+            std::uint64_t start = std::min(extent.offset, file_size_);
+            pending_hole_ += start - next_offset_;
+            next_offset_ = start;
+            data_end_ = std::min(extent.end, file_size_);
+        }
+        if (next_offset_ >= file_size_) {
+            slot.state = SlotState::Idle;
+            return;
+        }
+        slot.offset = next_offset_;
+        slot.expected = static_cast<std::size_t>(std::min<std::uint64_t>(block_size_, data_end_ - next_offset_));
+        slot.hole = std::exchange(pending_hole_, 0);
+        // O_DIRECT wants whole pages; the block buffer is a multiple of them
+        slot.iov.iov_len = cache_ == CachePolicy::Direct
+                               ? (slot.expected + kBlockAlign - 1) / kBlockAlign * kBlockAlign
+                               : slot.expected;
+        slot.result = 0;
+        slot.error = 0;
+        slot.state = SlotState::InFlight;
+        next_offset_ += slot.expected;
+        submit(slot);
+    }
+
+    std::uint64_t file_size_;
+    std::size_t block_size_;
+    CachePolicy cache_;
+    std::size_t lead_ = 0;             // Bytes to trim from the next block (Direct restarts)
+    std::uint64_t next_offset_ = 0;
+    std::uint64_t data_end_ = 0;       // End of the data extent holding next_offset_
+    std::uint64_t pending_hole_ = 0;   // Hole skipped, not yet reported with a block
+    std::size_t head_ = 0;  // Slot holding the lowest pending offset
+    bool handed_out_ = false;
+};
+
+// io_uring backend driven through the raw syscalls
+class IoUringPrefetcher : public SlotPrefetcher {
+public:
+    IoUringPrefetcher(int fd, std::uint64_t file_size, std::size_t block_size, std::size_t depth,
+                      CachePolicy cache)
+        : SlotPrefetcher(fd, file_size, block_size, depth, cache) {
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(slots_.size()), &params));
+        if (ring_fd_ < 0) {
+            throw std::runtime_error("io_uring unavailable");
+        }
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+
+        sq_ring_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_
+                               : mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      ring_fd_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_SQES);
+        if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+            if (sqes != MAP_FAILED) munmap(sqes, sqes_size_);
+            release_rings();
+            throw std::runtime_error("io_uring mmap failed");
+        }
+        sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        try {
+            restart(0);
+        } catch (const std::runtime_error&) {
+            // Submission refused (e.g. by seccomp): tear down, use threads
+            try { drain(); } catch (const std::runtime_error&) {}
+            munmap(sqes_, sqes_size_);
+            release_rings();
+            throw;
+        }
+    }
+
+    ~IoUringPrefetcher() override {
+        // The kernel may still be writing into our buffers
+        drain();
+        munmap(sqes_, sqes_size_);
+        release_rings();
+    }
+
+    const char* backend() const override { return "io_uring"; }
+
+protected:
+    void submit(Slot& slot) override {
+        unsigned tail = *sq_tail_;
+        unsigned index = tail & sq_mask_;
+        struct io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd_;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&slot.iov);
+        sqe->len = 1;
+        sqe->off = slot.offset;
+        sqe->user_data = static_cast<std::uint64_t>(&slot - slots_.data());
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+        ++in_flight_;
+        enter(1, 0, 0);
+    }
+
+    void wait(Slot& slot) override {
+        while (slot.state != SlotState::Ready) {
+            if (!reap()) enter(0, 1, IORING_ENTER_GETEVENTS);
+        }
+    }
+
+    void drain() override {
+        while (in_flight_ > 0) {
+            if (!reap()) enter(0, 1, IORING_ENTER_GETEVENTS);
+        }
+    }
+
+private:
+    void enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+        while (syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0) < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+            }
+        }
+    }
+
+    // Collect finished reads; returns false if there were none
+    bool reap() {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == tail) return false;
+        for (; head != tail; ++head) {
+            const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            Slot& slot = slots_[cqe.user_data];
+            if (cqe.res < 0) {
+                slot.error = -cqe.res;
+            } else {
+                slot.result = cqe.res;
+            }
+            slot.state = SlotState::Ready;
+            --in_flight_;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    void release_rings() {
+        if (cq_ring_ != sq_ring_ && cq_ring_ != MAP_FAILED && cq_ring_) munmap(cq_ring_, cq_size_);
+        if (sq_ring_ != MAP_FAILED && sq_ring_) munmap(sq_ring_, sq_size_);
+        ::close(ring_fd_);
+    }
+
+    int ring_fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    std::size_t sq_size_ = 0;
+    std::size_t cq_size_ = 0;
+    std::size_t sqes_size_ = 0;
+    struct io_uring_sqe* sqes_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    struct io_uring_cqe* cqes_ = nullptr;
+    std::size_t in_flight_ = 0;
+};
+
+// Portable backend: one worker thread issuing pread in submission order
+class ThreadPrefetcher : public SlotPrefetcher {
+public:
+    ThreadPrefetcher(int fd, std::uint64_t file_size, std::size_t block_size, std::size_t depth,
+                     CachePolicy cache)
+        : SlotPrefetcher(fd, file_size, block_size, depth, cache)
+        , worker_([this] { run(); }) {
+        restart(0);
+    }
+
+    ~ThreadPrefetcher() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    const char* backend() const override { return "pread-thread"; }
+
+protected:
+    void submit(Slot& slot) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(&slot);
+        }
+        cv_.notify_all();
+    }
+
+    void wait(Slot& slot) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return slot.state == SlotState::Ready; });
+    }
+
+    void drain() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return queue_.empty() && !busy_; });
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+
+            Slot* slot = queue_.front();
+            queue_.pop_front();
+            busy_ = true;
+            lock.unlock();
+
+            ssize_t n;
+            do {
+                n = pread(fd_, slot->data, slot->iov.iov_len, static_cast<off_t>(slot->offset));
+            } while (n < 0 && errno == EINTR);
+            int error = n < 0 ? errno : 0;
+
+            lock.lock();
+            slot->result = n < 0 ? 0 : n;
+            slot->error = error;
+            slot->state = SlotState::Ready;
+            busy_ = false;
+            cv_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Slot*> queue_;
+    bool busy_ = false;
+    bool stop_ = false;
+    std::thread worker_;
+};
+
+}  // namespace
+
+DataExtent next_data_extent(int fd, std::uint64_t offset) {
+    off_t data = lseek(fd, static_cast<off_t>(offset), SEEK_DATA);
+    if (data < 0) {
+        if (errno != ENXIO) {
+            // No hole support: everything is data
+            return DataExtent{offset, UINT64_MAX};
+        }
+        // Only hole (or nothing) from offset to the end of the file
+        struct stat st;
+        std::uint64_t size = fstat(fd, &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : offset;
+        size = std::max(size, offset);
+        return DataExtent{size, size};
+    }
+    off_t hole = lseek(fd, data, SEEK_HOLE);
+    return DataExtent{static_cast<std::uint64_t>(data),
+                      hole > data ? static_cast<std::uint64_t>(hole) : UINT64_MAX};
+}
+
+std::unique_ptr<BlockPrefetcher> make_block_prefetcher(
+    int fd,
+    std::uint64_t file_size,
+    std::size_t block_size,
+    std::size_t depth,
+    CachePolicy cache
+) {
+    block_size = (std::max(block_size, kBlockAlign) + kBlockAlign - 1) / kBlockAlign * kBlockAlign;
+
+    // FASTCAT_IO_URING=0 forces the thread backend
+    const char* use_uring = std::getenv("FASTCAT_IO_URING");
+    if (!use_uring || std::strcmp(use_uring, "0") != 0) {
+        try {
+            return std::make_unique<IoUringPrefetcher>(fd, file_size, block_size, depth, cache);
+        } catch (const std::runtime_error&) {
+            // Fall through to the portable backend
+        }
+    }
+    return std::make_unique<ThreadPrefetcher>(fd, file_size, block_size, depth, cache);
+}
+
+}  // namespace fastcat
@@ -0,0 +1,266 @@
+#include "content_sniff.h"
+#include "line_scan.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+// Lines looked at when guessing the syntax
+constexpr std::size_t kSyntaxLines = 64;
+
+// Alignment of the sample buffer
+constexpr std::size_t kSniffAlign = 4096;
+
+struct Bom {
+    const char* bytes;
+    std::size_t length;
+    TextEncoding encoding;
+};
+
+// UTF-32LE first: its mark starts with the UTF-16LE one
+constexpr Bom kBoms[] = {
+    {"\xEF\xBB\xBF", 3, TextEncoding::Utf8},
+    {"\xFF\xFE\x00\x00", 4, TextEncoding::Utf32LE},
+    {"\x00\x00\xFE\xFF", 4, TextEncoding::Utf32BE},
+    {"\xFF\xFE", 2, TextEncoding::Utf16LE},
+    {"\xFE\xFF", 2, TextEncoding::Utf16BE},
+};
+
+// Valid UTF-8, allowing a sequence cut off by the end of the sample
+bool is_utf8(const unsigned char* p, std::size_t len) {
+    std::size_t i = 0;
+    while (i < len) {
+        unsigned char c = p[i];
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+        std::size_t extra;
+        std::uint32_t min;
+        if ((c & 0xE0) == 0xC0) {
+            extra = 1;
+            min = 0x80;
+        } else if ((c & 0xF0) == 0xE0) {
+            extra = 2;
+            min = 0x800;
+        } else if ((c & 0xF8) == 0xF0) {
+            extra = 3;
+            min = 0x10000;
+        } else {
+            return false;
+        }
+
+        std::uint32_t cp = c & (0x3F >> extra);
+        for (std::size_t k = 1; k <= extra; ++k) {
+            if (i + k >= len) return true;
+            if ((p[i + k] & 0xC0) != 0x80) return false;
+            cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+        // Overlong forms, surrogates and values past U+10FFFF
+        if (cp < min || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) return false;
+        i += extra + 1;
+    }
+    return true;
+}
+
+bool starts_with(std::string_view s, std::string_view prefix) {
+    return s.substr(0, prefix.size()) == prefix;
+}
+
+std::string_view trim_left(std::string_view s) {
+    std::size_t i = 0;
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) ++i;
+    return s.substr(i);
+}
+
+// Syntax suggested by the first lines of a text sample, or "" if none
+// stands out
+std::string guess_syntax(std::string_view text) {
+    std::string_view start = trim_left(text);
+    if (starts_with(start, "#!")) {
+        std::string_view shebang = start.substr(0, start.find('\n'));
+        if (shebang.find("python") != std::string_view::npos) return "python";
+    }
+    if (!start.empty() && (start[0] == '{' || start[0] == '[')) {
+        std::string_view next = trim_left(start.substr(1));
+        if (next.empty() || std::strchr("\"{[]}-0123456789tfn", next[0])) return "json";
+    }
+
+    int cpp = 0, python = 0, markdown = 0;
+    std::size_t commas = 0;
+    int csv_rows = 0;
+    bool csv = true;
+    std::size_t lines = 0;
+    for (std::size_t pos = 0; pos < text.size() && lines < kSyntaxLines; ++lines) {
+        std::size_t nl = text.find('\n', pos);
+        std::string_view line = text.substr(pos, nl == std::string_view::npos ? std::string_view::npos : nl - pos);
+        pos = nl == std::string_view::npos ? text.size() : nl + 1;
+
+        if (starts_with(line, "#include") || starts_with(line, "#pragma") ||
+            starts_with(line, "#define") || starts_with(line, "namespace ") ||
+            starts_with(line, "template <") || starts_with(line, "template<")) {
+            ++cpp;
+        } else if (starts_with(line, "def ") || starts_with(line, "import ") ||
+                   (starts_with(line, "from ") && line.find(" import ") != std::string_view::npos) ||
+                   starts_with(line, "if __name__")) {
+            ++python;
+        } else if (starts_with(line, "## ") || starts_with(line, "### ") || starts_with(line, "```") ||
+                   starts_with(line, "|---") || starts_with(line, "| ---")) {
+            // Not "# ", which is as likely a shell or CMake comment
+            ++markdown;
+        }
+
+        // CSV: every non-empty line has the same, non-zero number of commas
+        if (!line.empty() && line != "\r") {
+            std::size_t n = static_cast<std::size_t>(std::count(line.begin(), line.end(), ','));
+            if (n == 0 || (csv_rows > 0 && n != commas)) csv = false;
+            commas = n;
+            ++csv_rows;
+        }
+    }
+
+    int best = std::max({cpp, python, markdown});
+    if (best >= 2) {
+        if (best == cpp && cpp > python && cpp > markdown) return "cpp";
+        if (best == python && python > cpp && python > markdown) return "python";
+        if (best == markdown && markdown > cpp && markdown > python) return "markdown";
+    }
+    if (best == 0 && csv && csv_rows >= 2) return "csv";
+    return "";
+}
+
+}  // namespace
+
+ContentInfo sniff_content(const char* data, std::size_t len) {
+    ContentInfo info;
+    if (len == 0) return info;
+    info.sniffed = true;
+
+    for (const Bom& bom : kBoms) {
+        if (len >= bom.length && std::memcmp(data, bom.bytes, bom.length) == 0) {
+            info.bom_length = bom.length;
+            info.encoding = bom.encoding;
+            break;
+        }
+    }
+
+    // Byte classes, newlines and line lengths in one vectorized pass
+    ByteStats stats = byte_stats(data + info.bom_length, len - info.bom_length);
+    std::size_t body = len - info.bom_length;
+
+    std::size_t lf = stats.newlines - stats.crlf;
+    int styles = (lf > 0) + (stats.crlf > 0) + (stats.lone_cr > 0);
+    if (styles > 1) {
+        info.line_ending = LineEnding::Mixed;
+    } else if (lf > 0) {
+        info.line_ending = LineEnding::LF;
+    } else if (stats.crlf > 0) {
+        info.line_ending = LineEnding::CRLF;
+    } else if (stats.lone_cr > 0) {
+        info.line_ending = LineEnding::CR;
+    }
+
+    std::size_t lines = stats.newlines + (data[len - 1] != '\n' ? 1 : 0);
+    info.avg_line_length = lines ? (body - stats.newlines) / lines : 0;
+    info.max_line_length = stats.max_line;
+
+    bool wide = info.encoding != TextEncoding::Ascii && info.encoding != TextEncoding::Utf8;
+    if (wide) {
+        // NULs are expected in UTF-16/32; trust the mark
+        return info;
+    }
+    if (stats.high > 0) {
+        bool utf8 = is_utf8(reinterpret_cast<const unsigned char*>(data + info.bom_length), body);
+        info.encoding = utf8 ? TextEncoding::Utf8 : TextEncoding::EightBit;
+    }
+
+    // Like grep and git: any NUL means binary, as do more than ~3%
+    // control bytes or a quarter of undecodable high bytes
+    info.binary = stats.nul > 0 || stats.control * 32 > body ||
+                  (info.encoding == TextEncoding::EightBit && stats.high * 4 > body);
+    if (!info.binary) {
+        info.syntax = guess_syntax(std::string_view(data + info.bom_length, body));
+    }
+    return info;
+}
+
+namespace {
+
+// Sample length for bytes from `offset` of fd: up to `want`, but stopping
+// where a hole starts, since a hole is not content. `cut` tells that it
+// stopped there. The file position is left alone.
+std::size_t sample_length(int fd, std::uint64_t offset, std::size_t want, bool& cut) {
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    off_t hole = lseek(fd, static_cast<off_t>(offset), SEEK_HOLE);
+    if (pos >= 0) lseek(fd, pos, SEEK_SET);
+    cut = hole >= 0 && static_cast<std::uint64_t>(hole) - offset < want;
+    return cut ? static_cast<std::size_t>(static_cast<std::uint64_t>(hole) - offset) : want;
+}
+
+// The zero padding of the block before a hole
+std::size_t trim_padding(const char* data, std::size_t len) {
+    while (len > 0 && data[len - 1] == '\0') --len;
+    return len;
+}
+
+}  // namespace
+
+ContentInfo sniff_file(int fd) {
+    bool cut = false;
+    std::size_t want = sample_length(fd, 0, kSniffBytes, cut);
+
+    // Page-aligned, so fd may be open with O_DIRECT
+    std::unique_ptr<char, decltype(&std::free)> buffer(
+        static_cast<char*>(std::aligned_alloc(kSniffAlign, kSniffBytes)), &std::free);
+    if (!buffer) return ContentInfo{};
+    std::size_t got = 0;
+    while (got < want) {
+        ssize_t n = pread(fd, buffer.get() + got, want - got, static_cast<off_t>(got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += static_cast<std::size_t>(n);
+    }
+    if (cut) got = trim_padding(buffer.get(), got);
+    return sniff_content(buffer.get(), got);
+}
+
+ContentInfo sniff_mapping(const char* data, std::size_t len, int fd, std::uint64_t offset) {
+    bool cut = false;
+    len = sample_length(fd, offset, std::min(len, kSniffBytes), cut);
+    if (cut) len = trim_padding(data, len);
+    return sniff_content(data, len);
+}
+
+const char* encoding_name(TextEncoding encoding) {
+    switch (encoding) {
+        case TextEncoding::Ascii: return "ascii";
+        case TextEncoding::Utf8: return "utf-8";
+        case TextEncoding::Utf16LE: return "utf-16le";
+        case TextEncoding::Utf16BE: return "utf-16be";
+        case TextEncoding::Utf32LE: return "utf-32le";
+        case TextEncoding::Utf32BE: return "utf-32be";
+        case TextEncoding::EightBit: return "8-bit";
+    }
+    return "unknown";
+}
+
+const char* line_ending_name(LineEnding ending) {
+    switch (ending) {
+        case LineEnding::None: return "none";
+        case LineEnding::LF: return "lf";
+        case LineEnding::CRLF: return "crlf";
+        case LineEnding::CR: return "cr";
+        case LineEnding::Mixed: return "mixed";
+    }
+    return "unknown";
+}
+
+}  // namespace fastcat
@@ -6,14 +6,14 @@
 
 namespace fastcat {
 
-bool looks_like_csv(const std::string& line) {
+bool looks_like_csv(std::string_view line) {
     // Simple heuristic: contains commas and not just a few
     std::size_t comma_count = std::count(line.begin(), line.end(), ',');
     std::size_t other_chars = line.length() - comma_count;
     return comma_count > 0 && other_chars > 0;
 }
 
-CsvRow parse_csv_row(const std::string& line) {
+CsvRow parse_csv_row(std::string_view line) {
     CsvRow row;
     std::size_t col = 0;
     std::size_t i = 0;
@@ -69,12 +69,10 @@ std::optional<CsvTable> parse_csv(
     std::size_t row_num = 0;
 
     // First pass: collect all rows and compute column widths
-    while (auto result = reader.read_line()) {
-        if (result->is_eof) break;
-
+    while (auto view = reader.read_line_view()) {
         if (max_rows > 0 && row_num >= max_rows) break;
 
-        CsvRow row = parse_csv_row(result->line);
+        CsvRow row = parse_csv_row(view->line);
         row_num++;
 
         // Update column widths
@@ -188,14 +186,14 @@ std::vector<std::string> format_rainbow_csv_table(const CsvTable& table) {
 }
 
 // Detect if a line looks like a markdown table row
-bool looks_like_md_table(const std::string& line) {
+bool looks_like_md_table(std::string_view line) {
     // Must start and end with | (or just have pipes)
     // And have at least one pipe in between
     std::size_t pipe_count = std::count(line.begin(), line.end(), '|');
 
     // Check for markdown table separator pattern: |---|---|
     // This is the second row of a markdown table
-    std::string trimmed = line;
+    std::string_view trimmed = line;
     // Trim leading and trailing spaces
     std::size_t start = 0;
     while (start < trimmed.length() && (trimmed[start] == ' ' || trimmed[start] == '\t')) ++start;
@@ -220,8 +218,8 @@ bool looks_like_md_table(const std::string& line) {
 }
 
 // Check if a line is a markdown table separator (only | - : and spaces)
-bool is_md_table_separator(const std::string& line) {
-    std::string trimmed = line;
+bool is_md_table_separator(std::string_view line) {
+    std::string_view trimmed = line;
     // Trim leading and trailing spaces
     std::size_t start = 0;
     while (start < trimmed.length() && (trimmed[start] == ' ' || trimmed[start] == '\t')) ++start;
@@ -0,0 +1,807 @@
+#include "decompress.h"
+#include "frame_index.h"
+#include "line_scan.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef FASTCAT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FASTCAT_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef FASTCAT_HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef FASTCAT_HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+namespace fastcat {
+
+namespace {
+
+// Compressed bytes read per read(2)
+constexpr std::size_t kInputChunk = 256 * 1024;
+
+// Upper bound on frame decoding threads
+constexpr std::size_t kMaxThreads = 16;
+
+// Largest frame decoded whole by ParallelFramePrefetcher. BGZF blocks are
+// at most 64 KiB and pzstd / seekable zstd frames a few MiB; files with
+// bigger frames (concatenated default zstd files) stream instead of
+// holding whole frames per slot and per thread.
+constexpr std::uint64_t kMaxParallelFrame = 4 * 1024 * 1024;
+
+// Most decoded bytes per compressed byte: deflate tops out near 1032:1,
+// zstd at one 128 KiB RLE block per 4 bytes
+constexpr std::uint64_t kMaxDeflateRatio = 1032;
+constexpr std::uint64_t kMaxZstdRatio = 32 * 1024;
+
+// One compression format. Only ever used from the decoder thread.
+class StreamDecoder {
+public:
+    struct Step {
+        std::size_t consumed;
+        std::size_t produced;
+        bool stream_end;  // A complete stream (gzip member, xz stream, ...) ended
+    };
+
+    virtual ~StreamDecoder() = default;
+
+    // Decode from `in` into `out`. `last` is set once the input has no more
+    // data after `in`. Throws std::runtime_error on corrupt data.
+    virtual Step step(const char* in, std::size_t in_len, char* out, std::size_t out_len, bool last) = 0;
+
+    // Prepare for the next concatenated stream, or the start of the file
+    virtual void reset() = 0;
+};
+
+[[noreturn]] void corrupt(const char* format) {
+    throw std::runtime_error(std::string("corrupt ") + format + " data");
+}
+
+#ifdef FASTCAT_HAVE_ZLIB
+class GzipDecoder : public StreamDecoder {
+public:
+    GzipDecoder() {
+        // 16 + MAX_WBITS: expect a gzip header
+        if (inflateInit2(&stream_, 16 + MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("inflateInit failed");
+        }
+    }
+
+    ~GzipDecoder() override { inflateEnd(&stream_); }
+
+    Step step(const char* in, std::size_t in_len, char* out, std::size_t out_len, bool) override {
+        uInt in_avail = static_cast<uInt>(std::min<std::size_t>(in_len, UINT32_MAX));
+        uInt out_avail = static_cast<uInt>(std::min<std::size_t>(out_len, UINT32_MAX));
+        stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+        stream_.avail_in = in_avail;
+        stream_.next_out = reinterpret_cast<Bytef*>(out);
+        stream_.avail_out = out_avail;
+
+        // Z_BUF_ERROR only means no progress was possible
+        int rc = inflate(&stream_, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+            corrupt("gzip");
+        }
+        return Step{in_avail - stream_.avail_in, out_avail - stream_.avail_out, rc == Z_STREAM_END};
+    }
+
+    void reset() override { inflateReset(&stream_); }
+
+private:
+    z_stream stream_{};
+};
+#endif
+
+#ifdef FASTCAT_HAVE_ZSTD
+class ZstdDecoder : public StreamDecoder {
+public:
+    ZstdDecoder() : stream_(ZSTD_createDStream()) {
+        if (!stream_) throw std::runtime_error("ZSTD_createDStream failed");
+    }
+
+    ~ZstdDecoder() override { ZSTD_freeDStream(stream_); }
+
+    Step step(const char* in, std::size_t in_len, char* out, std::size_t out_len, bool) override {
+        ZSTD_inBuffer input{in, in_len, 0};
+        ZSTD_outBuffer output{out, out_len, 0};
+        std::size_t rc = ZSTD_decompressStream(stream_, &output, &input);
+        if (ZSTD_isError(rc)) {
+            corrupt("zstd");
+        }
+        // Frames simply follow each other; 0 means one just ended
+        return Step{input.pos, output.pos, rc == 0};
+    }
+
+    void reset() override { ZSTD_DCtx_reset(stream_, ZSTD_reset_session_only); }
+
+private:
+    ZSTD_DStream* stream_;
+};
+#endif
+
+#ifdef FASTCAT_HAVE_LZMA
+class XzDecoder : public StreamDecoder {
+public:
+    XzDecoder() { reset(); }
+
+    ~XzDecoder() override { lzma_end(&stream_); }
+
+    Step step(const char* in, std::size_t in_len, char* out, std::size_t out_len, bool last) override {
+        stream_.next_in = reinterpret_cast<const uint8_t*>(in);
+        stream_.avail_in = in_len;
+        stream_.next_out = reinterpret_cast<uint8_t*>(out);
+        stream_.avail_out = out_len;
+
+        lzma_ret rc = lzma_code(&stream_, last ? LZMA_FINISH : LZMA_RUN);
+        if (rc != LZMA_OK && rc != LZMA_STREAM_END) {
+            corrupt("xz");
+        }
+        return Step{in_len - stream_.avail_in, out_len - stream_.avail_out, rc == LZMA_STREAM_END};
+    }
+
+    void reset() override {
+        lzma_end(&stream_);
+        stream_ = LZMA_STREAM_INIT;
+        // LZMA_CONCATENATED handles `cat a.xz b.xz` inside liblzma
+        if (lzma_stream_decoder(&stream_, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+            throw std::runtime_error("lzma_stream_decoder failed");
+        }
+    }
+
+private:
+    lzma_stream stream_ = LZMA_STREAM_INIT;
+};
+#endif
+
+#ifdef FASTCAT_HAVE_BZIP2
+class Bzip2Decoder : public StreamDecoder {
+public:
+    Bzip2Decoder() { init(); }
+
+    ~Bzip2Decoder() override { BZ2_bzDecompressEnd(&stream_); }
+
+    Step step(const char* in, std::size_t in_len, char* out, std::size_t out_len, bool) override {
+        stream_.next_in = const_cast<char*>(in);
+        stream_.avail_in = static_cast<unsigned>(std::min<std::size_t>(in_len, UINT32_MAX));
+        stream_.next_out = out;
+        stream_.avail_out = static_cast<unsigned>(std::min<std::size_t>(out_len, UINT32_MAX));
+        unsigned in_before = stream_.avail_in;
+        unsigned out_before = stream_.avail_out;
+
+        int rc = BZ2_bzDecompress(&stream_);
+        if (rc != BZ_OK && rc != BZ_STREAM_END) {
+            corrupt("bzip2");
+        }
+        return Step{in_before - stream_.avail_in, out_before - stream_.avail_out, rc == BZ_STREAM_END};
+    }
+
+    void reset() override {
+        BZ2_bzDecompressEnd(&stream_);
+        init();
+    }
+
+private:
+    void init() {
+        stream_ = bz_stream{};
+        if (BZ2_bzDecompressInit(&stream_, 0, 0) != BZ_OK) {
+            throw std::runtime_error("BZ2_bzDecompressInit failed");
+        }
+    }
+
+    bz_stream stream_{};
+};
+#endif
+
+std::unique_ptr<StreamDecoder> make_decoder(Compression type) {
+    switch (type) {
+#ifdef FASTCAT_HAVE_ZLIB
+        case Compression::Gzip: return std::make_unique<GzipDecoder>();
+#endif
+#ifdef FASTCAT_HAVE_ZSTD
+        case Compression::Zstd: return std::make_unique<ZstdDecoder>();
+#endif
+#ifdef FASTCAT_HAVE_LZMA
+        case Compression::Xz: return std::make_unique<XzDecoder>();
+#endif
+#ifdef FASTCAT_HAVE_BZIP2
+        case Compression::Bzip2: return std::make_unique<Bzip2Decoder>();
+#endif
+        default: break;
+    }
+    throw std::runtime_error(std::string("fastcat was built without ") +
+                             compression_name(type) + " support");
+}
+
+// Ring of output blocks filled by a decoder thread, handed out in order
+class DecompressingPrefetcher : public BlockPrefetcher {
+public:
+    DecompressingPrefetcher(int fd, Compression type, std::size_t block_size, std::size_t depth)
+        : fd_(fd), type_(type), decoder_(make_decoder(type)), block_size_(block_size),
+          input_(std::make_unique<char[]>(kInputChunk)) {
+        blocks_.resize(std::max<std::size_t>(depth, 2));
+        for (std::size_t i = 0; i < blocks_.size(); ++i) {
+            blocks_[i] = std::make_unique<char[]>(block_size_);
+            free_.push_back(i);
+        }
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~DecompressingPrefetcher() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    Block next() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // The block handed out last time is free again
+        if (handed_out_) {
+            free_.push_back(*handed_out_);
+            handed_out_.reset();
+            cv_.notify_all();
+        }
+
+        cv_.wait(lock, [&] { return !ready_.empty() || finished_; });
+        if (ready_.empty()) {
+            if (!error_.empty()) throw std::runtime_error(error_);
+            return Block{nullptr, 0};
+        }
+
+        auto [index, size] = ready_.front();
+        ready_.pop_front();
+        handed_out_ = index;
+        return Block{blocks_[index].get(), size};
+    }
+
+    void restart(std::uint64_t offset) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++generation_;
+            for (const auto& [index, size] : ready_) free_.push_back(index);
+            ready_.clear();
+            if (handed_out_) free_.push_back(*handed_out_);
+            handed_out_.reset();
+            finished_ = false;
+            error_.clear();
+            skip_ = offset;
+        }
+        cv_.notify_all();
+    }
+
+    const char* backend() const override {
+        return compression_name(type_);
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::uint64_t generation = generation_;
+        while (true) {
+            cv_.wait(lock, [&] {
+                return stop_ || generation != generation_ || (!finished_ && !free_.empty());
+            });
+            if (stop_) return;
+
+            if (generation != generation_) {
+                // Decode again from the top, dropping skip_ bytes on the way
+                generation = generation_;
+                skip_left_ = skip_;
+                lock.unlock();
+                rewind_input();
+                lock.lock();
+                continue;
+            }
+
+            std::size_t index = free_.front();
+            free_.pop_front();
+            lock.unlock();
+
+            std::size_t size = 0;
+            bool done = false;
+            std::string error;
+            try {
+                done = fill(blocks_[index].get(), size);
+            } catch (const std::runtime_error& e) {
+                error = e.what();
+                done = true;
+            }
+
+            lock.lock();
+            if (generation != generation_) {
+                free_.push_back(index);  // Restarted meanwhile; stale data
+                continue;
+            }
+            if (size > 0) {
+                ready_.emplace_back(index, size);
+            } else {
+                free_.push_back(index);
+            }
+            if (done) {
+                finished_ = true;
+                error_ = error;
+            }
+            cv_.notify_all();
+        }
+    }
+
+    void rewind_input() {
+        lseek(fd_, 0, SEEK_SET);
+        in_pos_ = in_len_ = 0;
+        input_eof_ = false;
+        in_stream_ = false;
+        decoder_->reset();
+    }
+
+    // Fill `out` with up to block_size_ decoded bytes. Returns true once the
+    // input is exhausted.
+    bool fill(char* out, std::size_t& size) {
+        size = 0;
+        while (size < block_size_) {
+            if (in_pos_ == in_len_ && !input_eof_) {
+                ssize_t n;
+                do {
+                    n = ::read(fd_, input_.get(), kInputChunk);
+                } while (n < 0 && errno == EINTR);
+                if (n < 0) {
+                    throw std::runtime_error(std::string("read failed: ") + std::strerror(errno));
+                }
+                in_pos_ = 0;
+                in_len_ = static_cast<std::size_t>(n);
+                input_eof_ = n == 0;
+            }
+            // Keep calling the decoder after the input ends until the
+            // stream is complete; it may still hold buffered output
+            if (in_pos_ == in_len_ && input_eof_ && !in_stream_) {
+                return true;
+            }
+
+            auto step = decoder_->step(input_.get() + in_pos_, in_len_ - in_pos_,
+                                       out + size, block_size_ - size, input_eof_);
+            in_pos_ += step.consumed;
+            if (step.consumed == 0 && step.produced == 0 && input_eof_ && !step.stream_end) {
+                throw std::runtime_error(std::string("truncated ") + compression_name(type_) + " data");
+            }
+
+            std::size_t produced = step.produced;
+            if (skip_left_ > 0) {
+                std::size_t drop = static_cast<std::size_t>(std::min<std::uint64_t>(skip_left_, produced));
+                std::memmove(out + size, out + size + drop, produced - drop);
+                skip_left_ -= drop;
+                produced -= drop;
+            }
+            size += produced;
+
+            in_stream_ = !step.stream_end;
+            if (step.stream_end && (in_pos_ < in_len_ || !input_eof_)) {
+                decoder_->reset();  // Another stream may follow
+            }
+        }
+        return false;
+    }
+
+    int fd_;
+    Compression type_;
+    std::unique_ptr<StreamDecoder> decoder_;
+    std::size_t block_size_;
+
+    // Decoder thread only
+    std::unique_ptr<char[]> input_;
+    std::size_t in_pos_ = 0;
+    std::size_t in_len_ = 0;
+    bool input_eof_ = false;
+    bool in_stream_ = false;    // Inside a stream that has not ended yet
+    std::uint64_t skip_left_ = 0;
+
+    // Guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::deque<std::size_t> free_;
+    std::deque<std::pair<std::size_t, std::size_t>> ready_;  // Block index, bytes
+    std::optional<std::size_t> handed_out_;
+    std::uint64_t generation_ = 0;
+    std::uint64_t skip_ = 0;
+    bool finished_ = false;
+    bool stop_ = false;
+    std::string error_;
+
+    std::thread worker_;
+};
+
+// Decode one whole frame of fd into out, which holds frame.raw_size bytes
+void decode_frame(StreamDecoder& decoder, int fd, const FrameIndex::Frame& frame,
+                  std::vector<char>& input, char* out, Compression type) {
+    input.resize(static_cast<std::size_t>(frame.size));
+    std::size_t got = 0;
+    while (got < input.size()) {
+        ssize_t n = pread(fd, input.data() + got, input.size() - got, static_cast<off_t>(frame.offset + got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error(std::string("truncated ") + compression_name(type) + " data");
+        got += static_cast<std::size_t>(n);
+    }
+
+    decoder.reset();
+    std::size_t in_pos = 0;
+    std::size_t out_pos = 0;
+    std::size_t raw_size = static_cast<std::size_t>(frame.raw_size);
+    while (true) {
+        auto step = decoder.step(input.data() + in_pos, input.size() - in_pos,
+                                 out + out_pos, raw_size - out_pos, true);
+        in_pos += step.consumed;
+        out_pos += step.produced;
+        if (step.stream_end) break;
+        if (step.consumed == 0 && step.produced == 0) corrupt(compression_name(type));
+    }
+    if (out_pos != raw_size) corrupt(compression_name(type));
+}
+
+// Decodes the frames of a FrameIndex on a pool of worker threads. Frames
+// are grouped into tasks of about kTaskSize decoded bytes; up to `depth`
+// tasks are decoded ahead of the consumer and handed out in file order.
+// Newline counts per frame are recorded as tasks are consumed, so line
+// seeks later only decode the frames they need.
+class ParallelFramePrefetcher : public BlockPrefetcher {
+public:
+    ParallelFramePrefetcher(int fd, Compression type, FrameIndex index,
+                            std::optional<FileKey> key, std::size_t threads)
+        : fd_(fd), type_(type), index_(std::move(index)), key_(key), threads_(threads) {
+        const auto& frames = index_.frames();
+        for (std::size_t k = 0; k < frames.size();) {
+            Task task{k, k, 0};
+            while (task.end < frames.size() && (task.raw_size < kTaskSize || task.end == k)) {
+                task.raw_size += static_cast<std::size_t>(frames[task.end++].raw_size);
+            }
+            tasks_.push_back(task);
+            k = task.end;
+        }
+
+        slots_.resize(threads_ * 2);
+        for (std::size_t i = 0; i < threads_; ++i) {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ParallelFramePrefetcher() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) worker.join();
+        store_index();
+    }
+
+    Block next() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // The task handed out last time is done with
+        if (handed_out_) {
+            slots_[head_ % slots_.size()].ready = false;
+            handed_out_ = false;
+            ++head_;
+            cv_.notify_all();
+        }
+        if (head_ >= tasks_.size()) {
+            return Block{nullptr, 0};
+        }
+
+        Slot& slot = slots_[head_ % slots_.size()];
+        cv_.wait(lock, [&] { return slot.ready && slot.task == head_; });
+        if (!slot.error.empty()) {
+            throw std::runtime_error(slot.error);
+        }
+
+        // Tasks arrive in order, so counts extend the known prefix
+        if (index_.counted() == tasks_[head_].first) {
+            for (std::size_t newlines : slot.newlines) index_.add_count(newlines);
+            dirty_ = true;
+        }
+
+        handed_out_ = true;
+        std::size_t skip = std::min(skip_, slot.size);
+        skip_ = 0;
+        return Block{slot.data.data() + skip, slot.size - skip};
+    }
+
+    void restart(std::uint64_t offset) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++generation_;
+            for (auto& slot : slots_) slot.ready = false;
+            handed_out_ = false;
+
+            if (offset >= index_.raw_size()) {
+                head_ = next_task_ = tasks_.size();
+                skip_ = 0;
+            } else {
+                std::size_t frame = index_.find(offset);
+                auto it = std::upper_bound(tasks_.begin(), tasks_.end(), frame,
+                                           [](std::size_t f, const Task& task) { return f < task.first; });
+                head_ = next_task_ = static_cast<std::size_t>(it - tasks_.begin()) - 1;
+                skip_ = static_cast<std::size_t>(offset - index_.frames()[tasks_[head_].first].raw_offset);
+            }
+        }
+        cv_.notify_all();
+    }
+
+    const char* backend() const override {
+        return type_ == Compression::Gzip ? "bgzf" : "zstd-frames";
+    }
+
+    std::optional<Position> locate_line(std::size_t line) override {
+        if (line == 0) return Position{0, 0};
+
+        // Count newlines of the frames not seen yet, in parallel batches,
+        // until the frame holding `line` is known
+        const auto& frames = index_.frames();
+        while (index_.counted() < frames.size() && index_.newlines_before(index_.counted()) < line) {
+            std::size_t first = index_.counted();
+            std::size_t end = std::min(frames.size(), first + threads_ * kCountBatch);
+            std::vector<std::size_t> counts(end - first);
+            std::vector<std::string> errors(threads_);
+            std::atomic<std::size_t> next{first};
+
+            std::vector<std::thread> pool;
+            for (std::size_t t = 0; t < threads_; ++t) {
+                pool.emplace_back([&, t] {
+                    try {
+                        auto decoder = make_decoder(type_);
+                        std::vector<char> input, output;
+                        for (std::size_t k; (k = next++) < end;) {
+                            output.resize(static_cast<std::size_t>(frames[k].raw_size));
+                            decode_frame(*decoder, fd_, frames[k], input, output.data(), type_);
+                            counts[k - first] = count_newlines(output.data(), output.size());
+                        }
+                    } catch (const std::exception& e) {
+                        errors[t] = e.what();
+                    }
+                });
+            }
+            for (auto& thread : pool) thread.join();
+            for (const auto& error : errors) {
+                if (!error.empty()) throw std::runtime_error(error);
+            }
+            for (std::size_t newlines : counts) index_.add_count(newlines);
+            dirty_ = true;
+        }
+        store_index();
+
+        std::size_t k = index_.frame_for_line(line);
+        return Position{frames[k].raw_offset, index_.newlines_before(k)};
+    }
+
+private:
+    struct Task {
+        std::size_t first;     // Frames [first, end)
+        std::size_t end;
+        std::size_t raw_size;
+    };
+
+    struct Slot {
+        std::vector<char> data;
+        std::size_t size = 0;
+        std::vector<std::size_t> newlines;  // Per frame of the task
+        std::string error;
+        std::size_t task = 0;
+        bool ready = false;
+    };
+
+    void run() {
+        std::unique_ptr<StreamDecoder> decoder;
+        std::vector<char> input;
+        Slot local;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [&] {
+                return stop_ || (next_task_ < tasks_.size() && next_task_ < head_ + slots_.size());
+            });
+            if (stop_) return;
+
+            std::size_t task_id = next_task_++;
+            std::uint64_t generation = generation_;
+            const Task& task = tasks_[task_id];
+            lock.unlock();
+
+            // Decode outside the lock into this worker's own buffers
+            local.error.clear();
+            local.newlines.clear();
+            local.size = task.raw_size;
+            try {
+                local.data.resize(task.raw_size);
+                if (!decoder) decoder = make_decoder(type_);
+                std::size_t at = 0;
+                for (std::size_t k = task.first; k < task.end; ++k) {
+                    const auto& frame = index_.frames()[k];
+                    decode_frame(*decoder, fd_, frame, input, local.data.data() + at, type_);
+                    local.newlines.push_back(count_newlines(local.data.data() + at,
+                                                            static_cast<std::size_t>(frame.raw_size)));
+                    at += static_cast<std::size_t>(frame.raw_size);
+                }
+            } catch (const std::exception& e) {
+                local.error = e.what();
+                local.size = 0;
+            }
+
+            lock.lock();
+            if (generation != generation_) continue;  // Restarted meanwhile; stale
+
+            // Swap buffers so the slot's old ones get reused by this worker
+            Slot& slot = slots_[task_id % slots_.size()];
+            std::swap(slot.data, local.data);
+            std::swap(slot.newlines, local.newlines);
+            std::swap(slot.error, local.error);
+            slot.size = local.size;
+            slot.task = task_id;
+            slot.ready = true;
+            cv_.notify_all();
+        }
+    }
+
+    void store_index() {
+        if (dirty_ && key_) {
+            index_.store_cached(*key_);
+            dirty_ = false;
+        }
+    }
+
+    int fd_;
+    Compression type_;
+    FrameIndex index_;              // Frames are fixed; counts change on the consumer side only
+    std::optional<FileKey> key_;
+    std::size_t threads_;
+    std::vector<Task> tasks_;
+    bool dirty_ = false;            // Counts grew since the cache was written
+
+    // Guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Slot> slots_;       // Task t lives in slots_[t % size]
+    std::size_t head_ = 0;          // Next task to hand out (or handed out)
+    std::size_t next_task_ = 0;     // Next task to decode
+    std::size_t skip_ = 0;          // Bytes to drop from the head task after restart()
+    bool handed_out_ = false;
+    std::uint64_t generation_ = 0;
+    bool stop_ = false;
+
+    std::vector<std::thread> workers_;
+
+    static constexpr std::size_t kTaskSize = 1024 * 1024;
+    static constexpr std::size_t kCountBatch = 16;  // Frames per thread per counting round
+};
+
+// Whether every frame is small enough to decode whole, and claims no more
+// decoded bytes than its compressed size can hold. The sizes come from
+// frame headers and trailers, so a corrupt file must not size buffers.
+bool frames_decodable_whole(const FrameIndex& index, Compression type) {
+    std::uint64_t max_ratio = type == Compression::Gzip ? kMaxDeflateRatio : kMaxZstdRatio;
+    for (const auto& frame : index.frames()) {
+        if (frame.raw_size > kMaxParallelFrame || frame.raw_size / max_ratio > frame.size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+Compression detect_compression(int fd) {
+    unsigned char magic[10] = {};
+    ssize_t n = pread(fd, magic, sizeof(magic), 0);
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return Compression::Gzip;
+    }
+    if (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return Compression::Zstd;
+    }
+    if (n >= 6 && std::memcmp(magic, "\xfd" "7zXZ\0", 6) == 0) {
+        return Compression::Xz;
+    }
+    // "BZh", the block size digit, then the magic of the first block (or
+    // of the end of an empty stream), so text that starts "BZh" stays text
+    if (n >= 10 && std::memcmp(magic, "BZh", 3) == 0 && magic[3] >= '1' && magic[3] <= '9' &&
+        (std::memcmp(magic + 4, "\x31\x41\x59\x26\x53\x59", 6) == 0 ||
+         std::memcmp(magic + 4, "\x17\x72\x45\x38\x50\x90", 6) == 0)) {
+        return Compression::Bzip2;
+    }
+    return Compression::None;
+}
+
+Compression detect_compression(const std::string& path) {
+    if (path == "-") return Compression::None;
+    // Only regular files are probed: opening and closing a FIFO here
+    // would lose what its writer sent before the real open
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return Compression::None;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return Compression::None;
+    Compression type = detect_compression(fd);
+    ::close(fd);
+    return type;
+}
+
+const char* compression_name(Compression type) {
+    switch (type) {
+        case Compression::Gzip: return "gzip";
+        case Compression::Zstd: return "zstd";
+        case Compression::Xz: return "xz";
+        case Compression::Bzip2: return "bzip2";
+        case Compression::None: break;
+    }
+    return "none";
+}
+
+bool compression_supported(Compression type) {
+    switch (type) {
+        case Compression::None: return true;
+#ifdef FASTCAT_HAVE_ZLIB
+        case Compression::Gzip: return true;
+#endif
+#ifdef FASTCAT_HAVE_ZSTD
+        case Compression::Zstd: return true;
+#endif
+#ifdef FASTCAT_HAVE_LZMA
+        case Compression::Xz: return true;
+#endif
+#ifdef FASTCAT_HAVE_BZIP2
+        case Compression::Bzip2: return true;
+#endif
+        default: return false;
+    }
+}
+
+std::string strip_compression_suffix(const std::string& path) {
+    static const char* const suffixes[] = {".gz", ".zst", ".xz", ".bz2", ".gzip", ".zstd"};
+    for (const char* suffix : suffixes) {
+        std::size_t len = std::strlen(suffix);
+        if (path.size() > len && path.compare(path.size() - len, len, suffix) == 0) {
+            return path.substr(0, path.size() - len);
+        }
+    }
+    return path;
+}
+
+std::unique_ptr<BlockPrefetcher> make_decompressor(
+    int fd,
+    Compression type,
+    std::size_t block_size,
+    std::size_t depth
+) {
+    // Independent frames decode in parallel; the frame layout is cached
+    // so later runs skip even the header walk
+    if ((type == Compression::Gzip || type == Compression::Zstd) && compression_supported(type)) {
+        auto key = file_key(fd);
+        std::optional<FrameIndex> index;
+        if (key) index = FrameIndex::load_cached(*key);
+        if (!index) {
+            index = FrameIndex::scan(fd, type);
+            if (index && key) index->store_cached(*key);
+        }
+        if (index && frames_decodable_whole(*index, type)) {
+            std::size_t threads = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, kMaxThreads);
+            return std::make_unique<ParallelFramePrefetcher>(fd, type, std::move(*index), key, threads);
+        }
+    }
+    return std::make_unique<DecompressingPrefetcher>(fd, type, block_size, depth);
+}
+
+}  // namespace fastcat
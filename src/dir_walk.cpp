@@ -0,0 +1,202 @@
+#include "dir_walk.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+// Record layout getdents64 fills its buffer with
+struct LinuxDirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Directory entries fetched per getdents64 call
+constexpr std::size_t kDirentBuffer = 64 * 1024;
+
+constexpr std::size_t kNoDir = static_cast<std::size_t>(-1);
+
+struct Entry {
+    std::string name;
+    std::size_t dir = kNoDir;  // Node of a subdirectory, kNoDir for a file
+};
+
+struct DirNode {
+    std::string path;
+    std::vector<Entry> entries;  // Sorted by name once the directory is read
+    bool listed = false;
+};
+
+std::string join_path(const std::string& dir, const std::string& name) {
+    return dir.empty() || dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+// Lists directories on a pool of threads into a tree of DirNodes, and
+// hands files out depth first, in name order, as far as the listings
+// allow. Nodes live in a deque so a reference taken under the lock stays
+// valid while other threads add nodes.
+class TreeWalker {
+public:
+    TreeWalker(const WalkOptions& options, const WalkCallback& found) : options_(options), found_(found) {}
+
+    void walk(const std::string& root) {
+        nodes_.push_back(DirNode{root, {}});
+        queue_.push_back(0);
+        pending_ = 1;
+        cursor_.emplace_back(0, 0);
+
+        std::vector<std::thread> threads;
+        std::size_t count = std::max<std::size_t>(options_.threads, 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            threads.emplace_back([this] { run(); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    void run() {
+        std::vector<char> buffer(kDirentBuffer);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [&] { return stop_ || pending_ == 0 || !queue_.empty(); });
+            if (stop_ || queue_.empty()) return;  // Stopped, or everything listed
+
+            std::size_t index = queue_.back();
+            queue_.pop_back();
+            DirNode& node = nodes_[index];
+            lock.unlock();
+
+            std::vector<Entry> entries = list(node.path, buffer);
+            std::sort(entries.begin(), entries.end(),
+                      [](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+            lock.lock();
+            // Queued last to first, so the first subdirectory, whose files
+            // are handed out next, is listed next
+            for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+                if (it->dir == kNoDir) continue;
+                it->dir = nodes_.size();
+                nodes_.push_back(DirNode{join_path(node.path, it->name), {}});
+                queue_.push_back(it->dir);
+                ++pending_;
+            }
+            node.entries = std::move(entries);
+            node.listed = true;
+            --pending_;
+            hand_out();
+            cv_.notify_all();
+        }
+    }
+
+    // Subdirectories come back with dir set to anything but kNoDir
+    std::vector<Entry> list(const std::string& path, std::vector<char>& buffer) {
+        std::vector<Entry> entries;
+        int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            warn(path);
+            return entries;
+        }
+
+        while (true) {
+            long n = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) warn(path);
+            if (n <= 0) break;
+
+            for (long offset = 0; offset < n;) {
+                auto* dirent = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+                offset += dirent->d_reclen;
+                const char* name = dirent->d_name;
+                if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) continue;
+
+                unsigned char type = dirent->d_type;
+                if (type == DT_UNKNOWN) {
+                    // Some filesystems leave the type to a stat
+                    struct stat st;
+                    if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                    type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+                }
+                if (type == DT_DIR) {
+                    entries.push_back(Entry{name, 0});
+                } else if (type == DT_REG) {
+                    entries.push_back(Entry{name, kNoDir});
+                }
+            }
+        }
+        ::close(fd);
+        return entries;
+    }
+
+    void warn(const std::string& path) {
+        int error = errno;
+        std::lock_guard<std::mutex> lock(warn_mutex_);
+        std::cerr << "Warning: Cannot read directory: " << path << ": " << std::strerror(error) << "\n";
+    }
+
+    // Hand out files depth first, in name order, up to the first directory
+    // not listed yet. Called with mutex_ held.
+    void hand_out() {
+        while (!cursor_.empty() && !stop_) {
+            auto [index, next] = cursor_.back();
+            DirNode& node = nodes_[index];
+            if (!node.listed) return;
+            if (next == node.entries.size()) {
+                // Done with it
+                std::vector<Entry>().swap(node.entries);
+                cursor_.pop_back();
+                continue;
+            }
+            ++cursor_.back().second;
+            const Entry& entry = node.entries[next];
+            if (entry.dir != kNoDir) {
+                cursor_.emplace_back(entry.dir, 0);
+            } else if (!found_(join_path(node.path, entry.name))) {
+                stop_ = true;
+            }
+        }
+    }
+
+    WalkOptions options_;
+    const WalkCallback& found_;
+    std::deque<DirNode> nodes_;
+    std::vector<std::size_t> queue_;  // Nodes waiting to be listed
+    std::size_t pending_ = 0;         // Nodes queued or being listed
+    std::vector<std::pair<std::size_t, std::size_t>> cursor_;  // Node, next entry: where hand_out() is
+    bool stop_ = false;               // found_ asked to stop
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::mutex warn_mutex_;
+};
+
+}  // namespace
+
+void walk_tree(const std::string& root, const WalkOptions& options, const WalkCallback& found) {
+    int fd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Cannot read directory: ") + std::strerror(errno));
+    }
+    ::close(fd);
+    TreeWalker(options, found).walk(root);
+}
+
+}  // namespace fastcat
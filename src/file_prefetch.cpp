@@ -0,0 +1,92 @@
+#include "file_prefetch.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+// Open `path` and ask for up to `limit` bytes from its start to be read
+// in. Returns the bytes requested; 0 for anything but a non-empty regular
+// file. stat() comes first so a FIFO is never opened (that would block,
+// or steal its writer from the real open).
+std::uint64_t warm_file(const std::string& path, std::uint64_t limit) {
+    struct stat st;
+    if (path == "-" || stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return 0;
+    }
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd < 0) return 0;
+    std::uint64_t bytes = std::min(static_cast<std::uint64_t>(st.st_size), limit);
+    posix_fadvise(fd, 0, static_cast<off_t>(bytes), POSIX_FADV_WILLNEED);
+    ::close(fd);
+    return bytes;
+}
+
+}  // namespace
+
+FilePrefetcher::FilePrefetcher(std::vector<std::string> paths, std::size_t depth, std::uint64_t budget)
+    : paths_(std::make_move_iterator(paths.begin()), std::make_move_iterator(paths.end())),
+      warmed_(paths_.size(), 0), depth_(depth), budget_(budget),
+      worker_([this] { run(); }) {
+}
+
+FilePrefetcher::~FilePrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+void FilePrefetcher::add(std::string path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        paths_.push_back(std::move(path));
+        warmed_.push_back(0);
+    }
+    cv_.notify_all();
+}
+
+void FilePrefetcher::advance(std::size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t i = current_ + 1; i <= index && i < warmed_.size(); ++i) {
+            ahead_ -= warmed_[i];
+        }
+        current_ = index;
+        next_ = std::max(next_, index + 1);
+    }
+    cv_.notify_all();
+}
+
+void FilePrefetcher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [&] {
+            return stop_ || (next_ < paths_.size() && next_ <= current_ + depth_ && ahead_ < budget_);
+        });
+        if (stop_) return;
+
+        std::size_t index = next_++;
+        std::uint64_t limit = budget_ - ahead_;
+        std::string path = paths_[index];  // add() may grow paths_ meanwhile
+        lock.unlock();
+
+        std::uint64_t bytes = warm_file(path, limit);
+
+        lock.lock();
+        // Skip the accounting if the file was printed meanwhile
+        if (index > current_) {
+            warmed_[index] = bytes;
+            ahead_ += bytes;
+        }
+    }
+}
+
+}  // namespace fastcat
@@ -1,13 +1,99 @@
 #include "file_reader.h"
-#include <fstream>
+#include "line_scan.h"
+#include "line_index.h"
+#include "block_prefetcher.h"
+#include "decompress.h"
+#include "reader_strategy.h"
 #include <iostream>
 #include <filesystem>
 #include <memory>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fastcat {
 
 namespace fs = std::filesystem;
 
+// Copy granularity when spooling input
+constexpr std::size_t kSpoolChunk = 256 * 1024;
+
+// Read size when scanning backwards for --tail
+constexpr std::size_t kTailChunk = 1024 * 1024;
+
+// Bytes mapped at a time for files too large to map whole
+constexpr std::size_t kMmapWindow = 256 * 1024 * 1024;
+
+// Decoded block size and blocks decoded ahead for compressed input
+constexpr std::size_t kDecompressBlock = 1024 * 1024;
+constexpr std::size_t kDecompressDepth = 4;
+
+namespace {
+
+// Data extents of bytes [offset, end) of fd, clipped to that range, in
+// file order
+std::vector<DataExtent> data_extents(int fd, std::uint64_t offset, std::uint64_t end) {
+    std::vector<DataExtent> extents;
+    for (std::uint64_t at = offset; at < end;) {
+        DataExtent extent = next_data_extent(fd, at);
+        if (extent.offset >= end) break;
+        extents.push_back(DataExtent{extent.offset, std::min(extent.end, end)});
+        at = extent.end;
+    }
+    return extents;
+}
+
+// fd's file opened again with O_DIRECT, or -1 if its filesystem refuses
+int open_direct(int fd) {
+    char self[64];
+    snprintf(self, sizeof(self), "/proc/self/fd/%d", fd);
+    return ::open(self, O_RDONLY | O_CLOEXEC | O_DIRECT);
+}
+
+}  // namespace
+
+namespace {
+
+FileSize size_category(std::uintmax_t size) {
+    if (size < 1024 * 1024) {
+        return FileSize::Small;
+    } else if (size < 100 * 1024 * 1024) {
+        return FileSize::Medium;
+    }
+    return FileSize::Large;
+}
+
+// get_file_info(fd, path), optionally without the content sniff for
+// readers that sniff their own mapping or whose bytes are not the text
+FileInfo describe_file(int fd, const std::string& path, bool sniff) {
+    FileInfo info;
+    info.path = path;
+    info.size = 0;
+
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0) {
+        info.size = static_cast<std::uintmax_t>(st.st_size);
+        if (sniff && S_ISREG(st.st_mode)) {
+            info.content = sniff_file(fd);
+        }
+    }
+    info.size_category = size_category(info.size);
+    return info;
+}
+
+}  // namespace
+
 FileInfo get_file_info(const std::string& path) {
     FileInfo info;
     info.path = path;
@@ -17,57 +103,218 @@ FileInfo get_file_info(const std::string& path) {
     } catch (const fs::filesystem_error&) {
         info.size = 0;
     }
-
-    if (info.size < 1024 * 1024) {
-        info.size_category = FileSize::Small;
-    } else if (info.size < 100 * 1024 * 1024) {
-        info.size_category = FileSize::Medium;
-    } else {
-        info.size_category = FileSize::Large;
-    }
+    info.size_category = size_category(info.size);
 
     return info;
 }
 
-// Streaming reader for large files
+FileInfo get_file_info(int fd, const std::string& path) {
+    return describe_file(fd, path, true);
+}
+
+std::size_t IFileReader::read_lines(std::span<LineView> out) {
+    // Conservative default: one line per batch, so a reader whose views
+    // share a single scratch buffer never hands out a stale view
+    if (out.empty()) return 0;
+    auto view = read_line_view();
+    if (!view) return 0;
+    out[0] = *view;
+    return 1;
+}
+
+std::optional<ReadResult> IFileReader::read_line() {
+    auto view = read_line_view();
+    if (!view) {
+        return ReadResult{"", 0, true};
+    }
+    return ReadResult{std::string(view->line), view->line_number, false};
+}
+
+// Line index behind a reader's seek(), loaded from the on-disk cache on
+// first use and written back whenever a seek extends it
+class ReaderIndex {
+public:
+    // Files smaller than this are rescanned rather than cached
+    static constexpr std::uint64_t kCacheMinSize = 8 * 1024 * 1024;
+
+    void reset(std::optional<FileKey> key) {
+        key_ = key;
+        index_.reset();
+    }
+
+    // Closest known line start at or before `line`, scanning forward through
+    // `source` first if needed. std::nullopt for non-regular files.
+    std::optional<LineIndex::Checkpoint> locate(
+        std::size_t line, const LineIndex::ChunkSource& source) {
+        if (!key_) return std::nullopt;
+
+        bool cacheable = key_->size >= kCacheMinSize;
+        if (!index_) {
+            if (cacheable) index_ = LineIndex::load_cached(*key_);
+            if (!index_) index_.emplace();
+        }
+        if (index_->cover(line, source) && cacheable) {
+            index_->store_cached(*key_);
+        }
+        return index_->lookup(line);
+    }
+
+    // Closest known line start at or before byte `offset`
+    std::optional<LineIndex::Checkpoint> locate_offset(
+        std::uint64_t offset, const LineIndex::ChunkSource& source) {
+        if (!key_) return std::nullopt;
+
+        bool cacheable = key_->size >= kCacheMinSize;
+        if (!index_) {
+            if (cacheable) index_ = LineIndex::load_cached(*key_);
+            if (!index_) index_.emplace();
+        }
+        if (index_->cover_offset(offset, source) && cacheable) {
+            index_->store_cached(*key_);
+        }
+        return index_->lookup_offset(offset);
+    }
+
+private:
+    std::optional<FileKey> key_;
+    std::optional<LineIndex> index_;
+};
+
+// Streaming reader for large files.
+// Reads with read(2) into one large page-aligned buffer; lines are handed
+// out as views into it. A line cut off by the end of the buffer is moved to
+// the front before the next refill, and the buffer only grows if a single
+// line is longer than it, so there is no per-line allocation. Reads stop
+// at the end of each data extent and holes after it are skipped.
 class StreamingFileReader : public IFileReader {
 public:
-    explicit StreamingFileReader(const std::string& path)
-        : file_(path), line_number_(0) {
-        if (!file_.is_open()) {
+    StreamingFileReader(const std::string& path, std::size_t buffer_size, bool show_holes = false)
+        : StreamingFileReader((path == "-") ? fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0)
+                                            : ::open(path.c_str(), O_RDONLY | O_CLOEXEC),
+                              path, buffer_size, show_holes) {
+    }
+
+    // Reads fd (owned), from its current position
+    StreamingFileReader(int fd, const std::string& path, std::size_t buffer_size, bool show_holes = false)
+        : path_(path), fd_(fd), show_holes_(show_holes), line_number_(0) {
+        capacity_ = std::clamp(buffer_size ? buffer_size : kDefaultBuffer, kMinBuffer, kMaxBuffer);
+        buffer_ = allocate_buffer(capacity_);
+
+        info_ = get_file_info(fd_, path);
+        if (fd_ < 0) {
             std::cerr << "Warning: Cannot open file: " << path << "\n";
+            return;
+        }
+
+        auto key = file_key(fd_);
+        seekable_ = key.has_value();
+        index_.reset(key);
+        if (seekable_) {
+            posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+            // Redirected stdin may not start at offset 0
+            off_t at = lseek(fd_, 0, SEEK_CUR);
+            file_offset_ = data_end_ = at > 0 ? static_cast<std::uint64_t>(at) : 0;
+        } else {
+            data_end_ = UINT64_MAX;
         }
     }
 
-    std::optional<ReadResult> read_line() override {
-        std::string line;
-        if (std::getline(file_, line)) {
-            ++line_number_;
-            return ReadResult{line, line_number_, false};
+    ~StreamingFileReader() override {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    StreamingFileReader(const StreamingFileReader&) = delete;
+    StreamingFileReader& operator=(const StreamingFileReader&) = delete;
+
+    std::optional<LineView> read_line_view() override {
+        while (true) {
+            std::size_t avail = end_ - begin_;
+            std::size_t nl = scanned_ + find_newline(buffer_.get() + begin_ + scanned_, avail - scanned_);
+            if (nl < avail) {
+                return take_line(nl, nl + 1);
+            }
+            scanned_ = avail;
+            if (auto line = cross_hole()) {
+                return line;
+            }
+            if (!refill()) {
+                // Final line without a trailing newline
+                return avail > 0 ? std::optional<LineView>(take_line(avail, avail)) : std::nullopt;
+            }
         }
-        return ReadResult{"", line_number_, true};
+    }
+
+    std::size_t read_lines(std::span<LineView> out) override {
+        // Views stay valid until the buffer is compacted, so a batch ends
+        // at the first line that would need a refill
+        std::size_t positions[kScanBatch];
+        std::size_t n = 0;
+        while (n < out.size()) {
+            std::size_t base = begin_ + scanned_;
+            std::size_t want = std::min(out.size() - n, kScanBatch);
+            std::size_t found = find_newlines(buffer_.get() + base, end_ - base, positions, want);
+
+            for (std::size_t k = 0; k < found; ++k) {
+                std::size_t nl = base + positions[k] - begin_;
+                out[n++] = take_line(nl, nl + 1);
+            }
+            if (found == want) continue;
+
+            scanned_ = end_ - begin_;
+            if (n > 0) break;
+            if (auto line = cross_hole()) {
+                out[n++] = *line;
+                break;
+            }
+            if (!refill()) {
+                if (scanned_ > 0) out[n++] = take_line(scanned_, scanned_);
+                break;
+            }
+        }
+        return n;
     }
 
     bool seek(std::size_t line_number) override {
-        // For streaming reader, seeking backwards is expensive
-        // We can only seek forward efficiently
-        if (line_number <= line_number_) {
-            // Rewind and read to the target line
-            file_.clear();
-            file_.seekg(0);
-            line_number_ = 0;
+        // Jump to the closest indexed line start, indexing up to the target
+        // first if this part of the file has not been scanned yet
+        std::unique_ptr<char[]> chunk;
+        auto checkpoint = index_.locate(line_number, [&](std::uint64_t offset) {
+            if (!chunk) chunk = std::make_unique<char[]>(kSeekChunk);
+            ssize_t n = pread(fd_, chunk.get(), kSeekChunk, static_cast<off_t>(offset));
+            return std::string_view(chunk.get(), n > 0 ? static_cast<std::size_t>(n) : 0);
+        });
+
+        if (line_number < line_number_) {
+            if (!reposition(0, 0)) return false;
+        }
+        if (checkpoint && checkpoint->line > line_number_) {
+            reposition(checkpoint->offset, checkpoint->line);
         }
 
-        std::string line;
-        while (line_number_ < line_number && std::getline(file_, line)) {
-            ++line_number_;
+        // Skip the remaining lines through the buffer with the newline kernel
+        std::size_t lines = line_number - line_number_;
+        bool partial = false;
+        while (lines > 0) {
+            std::size_t avail = end_ - begin_;
+            std::size_t pos = skip_lines(buffer_.get() + begin_, avail, lines);
+            if (lines > 0 && avail > 0) partial = buffer_[begin_ + avail - 1] != '\n';
+            begin_ += pos;
+            scanned_ = 0;
+            if (lines == 0) break;
+            if (!refill()) break;
         }
 
-        return file_.good() || file_.eof();
+        // A final line without a trailing newline still counts
+        if (lines == 1 && partial) {
+            lines = 0;
+        }
+        line_number_ = line_number - lines;
+        continued_ = false;
+        return lines == 0;
     }
 
     FileInfo info() const override {
-        return get_file_info(path_);
+        return info_;
     }
 
     bool is_large() const override {
@@ -75,71 +322,634 @@ public:
     }
 
     void rewind() override {
-        file_.clear();
-        file_.seekg(0);
-        line_number_ = 0;
+        reposition(0, 0);
     }
 
 private:
-    std::ifstream file_;
+    struct FreeDeleter {
+        void operator()(char* p) const { std::free(p); }
+    };
+    using Buffer = std::unique_ptr<char[], FreeDeleter>;
+
+    static Buffer allocate_buffer(std::size_t size) {
+        void* p = std::aligned_alloc(kBufferAlign, (size + kBufferAlign - 1) / kBufferAlign * kBufferAlign);
+        if (!p) throw std::bad_alloc();
+        return Buffer(static_cast<char*>(p));
+    }
+
+    // Hand out [begin_, begin_ + len) as the next line and consume `advance`
+    LineView take_line(std::size_t len, std::size_t advance) {
+        std::size_t number = std::exchange(continued_, false) ? line_number_ : ++line_number_;
+        LineView view{std::string_view(buffer_.get() + begin_, len), number};
+        begin_ += advance;
+        scanned_ = 0;
+        return view;
+    }
+
+    // Called when the buffer holds no complete line. If the next read
+    // would start in a hole, skip it: the partial line before the hole is
+    // handed out on its own, then the marker if enabled. std::nullopt once
+    // there is nothing (more) to hand out for the hole.
+    std::optional<LineView> cross_hole() {
+        if (hole_ == 0 && !skip_hole()) return std::nullopt;
+        if (begin_ < end_) {
+            // Zero fill up to the hole is block padding, not text
+            std::size_t len = end_ - begin_;
+            std::size_t text = len;
+            while (text > 0 && buffer_[begin_ + text - 1] == '\0') --text;
+            hole_ += len - text;
+            if (text == 0) {
+                begin_ = end_;
+                scanned_ = 0;
+            } else {
+                LineView piece = take_line(text, len);
+                continued_ = true;
+                return piece;
+            }
+        }
+        std::uint64_t size = std::exchange(hole_, 0);
+        if (!show_holes_) return std::nullopt;
+        return LineView{std::string_view(), line_number_, size};
+    }
+
+    // At the end of the current data extent, find the next one and move
+    // the file position there, leaving the size of the hole between them
+    // in hole_. Returns whether there was a hole.
+    bool skip_hole() {
+        if (file_offset_ < data_end_) return false;
+        DataExtent extent = next_data_extent(fd_, file_offset_);
+        lseek(fd_, static_cast<off_t>(extent.offset), SEEK_SET);
+        hole_ = extent.offset - file_offset_;
+        file_offset_ = extent.offset;
+        data_end_ = extent.end;
+        return hole_ > 0;
+    }
+
+    // Compact the unconsumed tail to the front and read more after it.
+    // Returns false at EOF or on error.
+    bool refill() {
+        if (fd_ < 0 || eof_) return false;
+
+        // Seeks skip holes without reporting them
+        skip_hole();
+        hole_ = 0;
+
+        std::size_t pending = end_ - begin_;
+        if (begin_ > 0) {
+            std::memmove(buffer_.get(), buffer_.get() + begin_, pending);
+            begin_ = 0;
+            end_ = pending;
+        }
+        if (end_ == capacity_) {
+            // One line fills the whole buffer: grow rather than split it
+            Buffer bigger = allocate_buffer(capacity_ * 2);
+            std::memcpy(bigger.get(), buffer_.get(), end_);
+            buffer_ = std::move(bigger);
+            capacity_ *= 2;
+        }
+
+        // Stop at the end of the data extent rather than read a hole
+        std::size_t want = static_cast<std::size_t>(
+            std::min<std::uint64_t>(capacity_ - end_, data_end_ - file_offset_));
+        ssize_t n;
+        do {
+            n = ::read(fd_, buffer_.get() + end_, want);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            eof_ = true;
+            return false;
+        }
+        end_ += static_cast<std::size_t>(n);
+        file_offset_ += static_cast<std::uint64_t>(n);
+
+        // Start the next window on its way while this one is consumed
+        if (seekable_) {
+            posix_fadvise(fd_, static_cast<off_t>(file_offset_), static_cast<off_t>(capacity_),
+                          POSIX_FADV_WILLNEED);
+        }
+        return true;
+    }
+
+    // Drop the buffer and continue reading at `offset`, which starts line
+    // `line` + 1. Fails on pipes and other non-seekable inputs.
+    bool reposition(std::uint64_t offset, std::size_t line) {
+        if (!seekable_ || lseek(fd_, static_cast<off_t>(offset), SEEK_SET) < 0) {
+            return false;
+        }
+        begin_ = end_ = scanned_ = 0;
+        file_offset_ = offset;
+        data_end_ = offset;
+        hole_ = 0;
+        continued_ = false;
+        eof_ = false;
+        line_number_ = line;
+        return true;
+    }
+
+    std::string path_;
+    FileInfo info_;                     // Sniffed once at open
+    int fd_ = -1;
+    bool seekable_ = false;
+    bool show_holes_;
+    bool eof_ = false;
+    Buffer buffer_;
+    std::size_t capacity_ = 0;
+    std::size_t begin_ = 0;             // First unconsumed byte
+    std::size_t end_ = 0;               // One past the last valid byte
+    std::size_t scanned_ = 0;           // Bytes after begin_ known to hold no newline
+    std::uint64_t file_offset_ = 0;     // File offset of buffer_[end_]
+    std::uint64_t data_end_ = 0;        // End of the data extent holding file_offset_
+    std::uint64_t hole_ = 0;            // Hole skipped but not yet handed out
+    bool continued_ = false;            // Next line is the rest of one split by a hole
     std::size_t line_number_;
+    ReaderIndex index_;
+
+    static constexpr std::size_t kDefaultBuffer = 4 * 1024 * 1024;
+    static constexpr std::size_t kMinBuffer = 1 * 1024 * 1024;
+    static constexpr std::size_t kMaxBuffer = 8 * 1024 * 1024;
+    static constexpr std::size_t kBufferAlign = 4096;
+    static constexpr std::size_t kScanBatch = 256;
+    static constexpr std::size_t kSeekChunk = 1024 * 1024;
+};
+
+// Asynchronous reader for very large files.
+// A BlockPrefetcher keeps several block reads in flight (io_uring, or a
+// pread thread as fallback) while lines of the current block are consumed,
+// so disk I/O overlaps highlighting and output. A line crossing a block
+// boundary is stitched together in a reused carry buffer; one crossing a
+// skipped hole is handed out in two pieces.
+class AsyncFileReader : public IFileReader {
+public:
+    // Reads the first `size` bytes of fd (owned); size is given because
+    // fstat reports 0 for block devices. With CachePolicy::Direct blocks
+    // are read through direct_fd (owned), the same file opened O_DIRECT,
+    // and fd only serves the sniff and the line index.
+    AsyncFileReader(int fd, const std::string& path, std::uint64_t size, std::size_t block_size,
+                    bool show_holes = false, CachePolicy cache = CachePolicy::Normal, int direct_fd = -1)
+        : path_(path), fd_(fd), direct_fd_(direct_fd), cache_(cache), show_holes_(show_holes), line_number_(0) {
+        // Sniffed through fd: an O_DIRECT pread of a sample cut at an
+        // unaligned EOF fails with EINVAL
+        info_ = get_file_info(fd_, path);
+        info_.size = size;
+        info_.size_category = size_category(size);
+        if (fd_ < 0) {
+            std::cerr << "Warning: Cannot open file: " << path << "\n";
+            return;
+        }
+
+        auto key = file_key(fd_);
+        index_.reset(key);
+        if (cache_ == CachePolicy::Normal) {
+            posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        } else {
+            // Drop what the compression probe and the sniff read through
+            // the cache
+            posix_fadvise(fd_, 0, static_cast<off_t>(kSniffBytes), POSIX_FADV_DONTNEED);
+        }
+
+        block_size = std::clamp(block_size ? block_size : kDefaultBlock, kMinBlock, kMaxBlock);
+        prefetcher_ = make_block_prefetcher(direct_fd_ >= 0 ? direct_fd_ : fd_, size, block_size, kDepth, cache_);
+    }
+
+    // Lines of the output of `prefetcher`, which reads fd (owned). Offsets
+    // do not match the file, so there is no line index; seeks skip forward.
+    AsyncFileReader(const std::string& path, int fd, std::unique_ptr<BlockPrefetcher> prefetcher)
+        : path_(path), info_(describe_file(fd, path, false)), fd_(fd), prefetcher_(std::move(prefetcher)),
+          show_holes_(false), line_number_(0) {
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    ~AsyncFileReader() override {
+        // Reads may still target the prefetcher's buffers and our fd
+        prefetcher_.reset();
+        if (fd_ >= 0) ::close(fd_);
+        if (direct_fd_ >= 0) ::close(direct_fd_);
+    }
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    std::optional<LineView> read_line_view() override {
+        release_carry();
+        while (prefetcher_) {
+            if (hole_ > 0) {
+                if (auto line = cross_hole()) return line;
+            }
+            if (pos_ < block_.size) {
+                std::size_t avail = block_.size - pos_;
+                std::size_t nl = find_newline(block_.data + pos_, avail);
+                if (nl < avail) {
+                    return take_line(nl);
+                }
+                carry_.append(block_.data + pos_, avail);
+                pos_ = block_.size;
+            }
+            if (!next_block() && hole_ == 0) {
+                return carry_.empty() ? std::nullopt : std::optional<LineView>(take_carry());
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::size_t read_lines(std::span<LineView> out) override {
+        // Fetching the next block recycles the current one, so a batch ends
+        // at the block boundary unless nothing has been handed out yet
+        release_carry();
+        std::size_t positions[kScanBatch];
+        std::size_t n = 0;
+        while (prefetcher_ && n < out.size()) {
+            if (hole_ > 0) {
+                if (n > 0) break;
+                if (auto line = cross_hole()) {
+                    out[n++] = *line;
+                    break;
+                }
+            }
+            if (pos_ >= block_.size) {
+                if (n > 0) break;
+                if (!next_block()) {
+                    if (hole_ > 0) continue;
+                    if (!carry_.empty()) out[n++] = take_carry();
+                    break;
+                }
+                continue;
+            }
+
+            std::size_t base = pos_;
+            std::size_t want = std::min(out.size() - n, kScanBatch);
+            std::size_t found = find_newlines(block_.data + base, block_.size - base, positions, want);
+            for (std::size_t k = 0; k < found; ++k) {
+                out[n++] = take_line(base + positions[k] - pos_);
+            }
+            if (found == want) continue;
+
+            // Only a partial line is left in this block
+            if (n > 0) break;
+            carry_.append(block_.data + pos_, block_.size - pos_);
+            pos_ = block_.size;
+        }
+        return n;
+    }
+
+    bool seek(std::size_t line_number) override {
+        if (!prefetcher_) return false;
+
+        // Jump to the closest indexed line start, indexing up to the target
+        // first if this part of the file has not been scanned yet
+        std::unique_ptr<char[]> chunk;
+        auto checkpoint = index_.locate(line_number, [&](std::uint64_t offset) {
+            if (!chunk) chunk = std::make_unique<char[]>(kSeekChunk);
+            ssize_t n = pread(fd_, chunk.get(), kSeekChunk, static_cast<off_t>(offset));
+            if (n > 0 && cache_ != CachePolicy::Normal) {
+                posix_fadvise(fd_, static_cast<off_t>(offset), n, POSIX_FADV_DONTNEED);
+            }
+            return std::string_view(chunk.get(), n > 0 ? static_cast<std::size_t>(n) : 0);
+        });
+        if (!checkpoint) {
+            // Compressed input: the decoder may know where the line's frame is
+            if (auto position = prefetcher_->locate_line(line_number)) {
+                checkpoint = LineIndex::Checkpoint{position->newlines, position->offset};
+            }
+        }
+
+        if (line_number < line_number_) {
+            reposition(0, 0);
+        }
+        if (checkpoint && checkpoint->line > line_number_) {
+            reposition(checkpoint->offset, checkpoint->line);
+        }
+
+        // Skip the remaining lines block by block with the newline kernel
+        release_carry();
+        bool partial = !carry_.empty();
+        carry_.clear();
+        std::size_t lines = line_number - line_number_;
+        while (lines > 0) {
+            if (pos_ >= block_.size && !next_block()) break;
+            std::size_t step = skip_lines(block_.data + pos_, block_.size - pos_, lines);
+            if (lines == 0) {
+                pos_ += step;
+                partial = false;
+                break;
+            }
+            partial = block_.data[block_.size - 1] != '\n';
+            pos_ = block_.size;
+        }
+
+        // A final line without a trailing newline still counts
+        if (lines == 1 && partial) {
+            lines = 0;
+        }
+        line_number_ = line_number - lines;
+        hole_ = 0;
+        continued_ = false;
+        return lines == 0;
+    }
+
+    FileInfo info() const override {
+        return info_;
+    }
+
+    bool is_large() const override {
+        return true;
+    }
+
+    void rewind() override {
+        if (prefetcher_) reposition(0, 0);
+    }
+
+private:
+    bool next_block() {
+        block_ = prefetcher_->next();
+        pos_ = 0;
+        hole_ += block_.hole;
+        return block_.size > 0;
+    }
+
+    // A hole ahead of the block just fetched ends the carried partial
+    // line, which is handed out on its own; the marker follows if enabled.
+    // std::nullopt once there is nothing (more) to hand out for the hole.
+    std::optional<LineView> cross_hole() {
+        if (!carry_.empty()) {
+            // Zero fill up to the hole is block padding, not text
+            std::size_t text = carry_.find_last_not_of('\0') + 1;  // npos + 1 == 0
+            hole_ += carry_.size() - text;
+            carry_.resize(text);
+        }
+        if (!carry_.empty()) {
+            LineView piece = take_carry();
+            continued_ = true;
+            return piece;
+        }
+        std::uint64_t size = std::exchange(hole_, 0);
+        if (!show_holes_) return std::nullopt;
+        return LineView{std::string_view(), line_number_, size};
+    }
+
+    std::size_t next_line_number() {
+        return std::exchange(continued_, false) ? line_number_ : ++line_number_;
+    }
+
+    // Line of `len` bytes at pos_, prefixed by any carried-over bytes
+    LineView take_line(std::size_t len) {
+        std::string_view line(block_.data + pos_, len);
+        pos_ += len + 1;
+        if (!carry_.empty() && !carry_handed_out_) {
+            carry_.append(line);
+            return take_carry();
+        }
+        return LineView{line, next_line_number()};
+    }
+
+    LineView take_carry() {
+        carry_handed_out_ = true;
+        return LineView{carry_, next_line_number()};
+    }
+
+    // The carry buffer backs at most one outstanding view
+    void release_carry() {
+        if (carry_handed_out_) {
+            carry_.clear();
+            carry_handed_out_ = false;
+        }
+    }
+
+    void reposition(std::uint64_t offset, std::size_t line) {
+        prefetcher_->restart(offset);
+        block_ = BlockPrefetcher::Block{nullptr, 0};
+        pos_ = 0;
+        carry_.clear();
+        carry_handed_out_ = false;
+        hole_ = 0;
+        continued_ = false;
+        line_number_ = line;
+    }
+
     std::string path_;
+    FileInfo info_;                     // Sniffed once at open (not for compressed input)
+    int fd_ = -1;
+    int direct_fd_ = -1;                // O_DIRECT descriptor the blocks are read through, if any
+    CachePolicy cache_ = CachePolicy::Normal;
+    std::unique_ptr<BlockPrefetcher> prefetcher_;
+    BlockPrefetcher::Block block_{nullptr, 0};
+    std::size_t pos_ = 0;
+    std::string carry_;                 // Line pieces spanning blocks
+    bool carry_handed_out_ = false;
+    bool show_holes_;
+    std::uint64_t hole_ = 0;            // Hole skipped but not yet handed out
+    bool continued_ = false;            // Next line is the rest of one split by a hole
+    std::size_t line_number_;
+    ReaderIndex index_;
+
+    static constexpr std::size_t kDefaultBlock = 4 * 1024 * 1024;
+    static constexpr std::size_t kMinBlock = 1 * 1024 * 1024;
+    static constexpr std::size_t kMaxBlock = 8 * 1024 * 1024;
+    static constexpr std::size_t kDepth = 4;  // Blocks in flight, including the one being consumed
+    static constexpr std::size_t kScanBatch = 256;
+    static constexpr std::size_t kSeekChunk = 1024 * 1024;
 };
 
-// Memory-mapped reader for small files (faster random access)
-class MemoryMappedReader : public IFileReader {
+// Read-only mapping of a byte range of a file. mmap needs a page-aligned
+// start, so a few bytes ahead of the range may be mapped but not exposed.
+class FileMapping {
 public:
-    explicit MemoryMappedReader(const std::string& path) : line_number_(0) {
-        file_.open(path, std::ios::binary);
-        if (file_.is_open()) {
-            file_size_ = fs::file_size(path);
-            mapping_ = std::make_unique<char[]>(file_size_);
-            file_.read(mapping_.get(), file_size_);
+    FileMapping() = default;
+
+    ~FileMapping() {
+        if (base_) {
+            munmap(base_, length_);
         }
     }
 
-    std::optional<ReadResult> read_line() override {
-        if (offset_ >= file_size_) {
-            return ReadResult{"", line_number_, true};
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+
+    // Map [offset, offset + length) of fd, clipped to the file size.
+    // Leaves the mapping empty if there is nothing to map or mmap fails.
+    void map(int fd, std::uint64_t offset = 0, std::uint64_t length = UINT64_MAX) {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || offset >= static_cast<std::uint64_t>(st.st_size)) return;
+        length = std::min<std::uint64_t>(length, st.st_size - offset);
+
+        static const std::uint64_t page = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+        std::uint64_t aligned = offset / page * page;
+        std::size_t lead = static_cast<std::size_t>(offset - aligned);
+
+        void* addr = mmap(nullptr, lead + length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(aligned));
+        if (addr == MAP_FAILED) return;
+
+        base_ = addr;
+        length_ = lead + length;
+        data_ = static_cast<const char*>(addr) + lead;
+        size_ = static_cast<std::size_t>(length);
+    }
+
+    // madvise() the pages covering [offset, offset + length) of the range
+    void advise(std::size_t offset, std::size_t length, int advice) const {
+        if (!base_ || length == 0) return;
+        static const std::uintptr_t page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+        auto begin = reinterpret_cast<std::uintptr_t>(data_ + offset) / page * page;
+        auto end = reinterpret_cast<std::uintptr_t>(data_ + offset + length);
+        madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+    }
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    void* base_ = nullptr;
+    std::size_t length_ = 0;
+    const char* data_ = nullptr;    // First byte of the requested range
+    std::size_t size_ = 0;
+};
+
+// Memory-mapped reader for small, cached or randomly accessed files
+// The file is mapped read-only and lines are sliced straight out of the
+// mapping, so opening costs no up-front copy regardless of file size.
+class MemoryMappedReader : public IFileReader {
+public:
+    explicit MemoryMappedReader(const std::string& path, bool show_holes = false)
+        : MemoryMappedReader(::open(path.c_str(), O_RDONLY | O_CLOEXEC), path, show_holes) {
+    }
+
+    // Map an already open descriptor; takes ownership of fd
+    MemoryMappedReader(int fd, const std::string& path, bool show_holes = false)
+        : path_(path), show_holes_(show_holes), line_number_(0) {
+        if (fd < 0) {
+            std::cerr << "Warning: Cannot open file: " << path << "\n";
+            info_ = describe_file(fd, path, false);
+            return;
         }
 
-        std::size_t start = offset_;
-        while (offset_ < file_size_ && mapping_[offset_] != '\n') {
-            ++offset_;
+        index_.reset(file_key(fd));
+        map(fd, 0, UINT64_MAX);
+
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+    }
+
+    // Map only bytes [offset, offset + length) of fd (clipped to the file),
+    // numbering its first line first_line + 1. Takes ownership of fd.
+    MemoryMappedReader(int fd, const std::string& path, std::uint64_t offset,
+                       std::uint64_t length, std::size_t first_line, bool show_holes = false)
+        : path_(path), show_holes_(show_holes), line_number_(first_line), base_line_(first_line) {
+        // Offsets are window-relative, so no line index
+        map(fd, offset, length);
+        ::close(fd);
+    }
+
+    MemoryMappedReader(const MemoryMappedReader&) = delete;
+    MemoryMappedReader& operator=(const MemoryMappedReader&) = delete;
+
+    std::optional<LineView> read_line_view() override {
+        while (true) {
+            std::size_t end = data_end();
+            if (hole_ > 0) {
+                std::uint64_t size = std::exchange(hole_, 0);
+                if (show_holes_) return LineView{std::string_view(), line_number_, size};
+            }
+            if (offset_ >= size_) {
+                return std::nullopt;
+            }
+
+            std::size_t start = offset_;
+            std::size_t nl = start + find_newline(data_ + start, end - start);
+            if (nl < end) {
+                offset_ = nl + 1;
+                return LineView{std::string_view(data_ + start, nl - start), next_line_number()};
+            }
+            if (auto rest = take_rest(end)) {
+                return rest;
+            }
         }
+    }
+
+    std::size_t read_lines(std::span<LineView> out) override {
+        // The mapping never moves, so a batch can be as large as requested.
+        // Newlines are located in bulk, kScanBatch at a time.
+        std::size_t positions[kScanBatch];
+        std::size_t n = 0;
+        while (n < out.size()) {
+            std::size_t end = data_end();
+            if (hole_ > 0) {
+                std::uint64_t size = std::exchange(hole_, 0);
+                if (show_holes_) {
+                    out[n++] = LineView{std::string_view(), line_number_, size};
+                    continue;
+                }
+            }
+            if (offset_ >= size_) break;
+
+            std::size_t want = std::min(out.size() - n, kScanBatch);
+            std::size_t base = offset_;
+            std::size_t found = find_newlines(data_ + base, end - base, positions, want);
 
-        std::string line(mapping_.get() + start, offset_ - start);
-        if (offset_ < file_size_) ++offset_;  // Skip newline
-        ++line_number_;
+            std::size_t line_start = 0;
+            for (std::size_t k = 0; k < found; ++k) {
+                out[n++] = LineView{
+                    std::string_view(data_ + base + line_start, positions[k] - line_start),
+                    next_line_number()};
+                line_start = positions[k] + 1;
+            }
+            offset_ = base + line_start;
 
-        return ReadResult{line, line_number_, false};
+            if (found < want) {
+                // No newline left in this extent
+                if (auto rest = take_rest(end)) out[n++] = *rest;
+            }
+        }
+        return n;
     }
 
     bool seek(std::size_t line_number) override {
-        if (line_number == 0) {
-            offset_ = 0;
-            line_number_ = 0;
-            return true;
+        if (line_number < base_line_) {
+            return false;
         }
 
+        auto checkpoint = index_.locate(line_number, [this](std::uint64_t offset) {
+            std::size_t n = std::min<std::uint64_t>(kIndexChunk, size_ - offset);
+            return std::string_view(data_ + offset, n);
+        });
+
         if (line_number < line_number_) {
             // Rewind and find the line
-            offset_ = 0;
-            line_number_ = 0;
+            rewind();
+        }
+        if (checkpoint && checkpoint->line > line_number_) {
+            offset_ = checkpoint->offset;
+            line_number_ = checkpoint->line;
         }
 
-        while (line_number_ < line_number) {
-            auto result = read_line();
-            if (result && result->is_eof) {
-                return false;
+        // Skip the remaining lines extent by extent, never touching holes
+        std::size_t lines = line_number - line_number_;
+        bool partial = false;
+        while (lines > 0) {
+            std::size_t end = data_end();
+            if (offset_ >= size_) break;
+            std::size_t pos = skip_lines(data_ + offset_, end - offset_, lines);
+            if (lines == 0) {
+                offset_ += pos;
+                break;
             }
+            // skip_lines() took the whole extent; whether the data ends in
+            // a newline decides if an unterminated last line is left
+            if (end > offset_) partial = data_[end - 1] != '\n';
+            offset_ = end;
         }
 
-        return true;
+        // A final line without a trailing newline still counts
+        if (lines > 0 && partial) {
+            offset_ = size_;
+            --lines;
+        }
+        line_number_ = line_number - lines;
+        hole_ = 0;
+        continued_ = false;
+        return lines == 0;
     }
 
     FileInfo info() const override {
-        return get_file_info(path_);
+        return info_;
     }
 
     bool is_large() const override {
@@ -148,34 +958,1009 @@ public:
 
     void rewind() override {
         offset_ = 0;
-        line_number_ = 0;
+        extent_ = 0;
+        hole_ = 0;
+        continued_ = false;
+        line_number_ = base_line_;
     }
 
 private:
-    std::ifstream file_;
-    std::unique_ptr<char[]> mapping_;
-    std::size_t file_size_;
-    std::size_t offset_;
+    void map(int fd, std::uint64_t offset, std::uint64_t length) {
+        mapping_.map(fd, offset, length);
+        data_ = mapping_.data();
+        size_ = mapping_.size();
+
+        // The sniff reads straight from the mapping
+        info_ = describe_file(fd, path_, false);
+        info_.content = sniff_mapping(data_, size_, fd, offset);
+
+        // Only the data extents are scanned; holes would read as zeros
+        for (const DataExtent& extent : data_extents(fd, offset, offset + size_)) {
+            extents_.push_back(DataExtent{extent.offset - offset, extent.end - offset});
+        }
+
+        // Lines are consumed front to back; ask the kernel for
+        // aggressive readahead and to start faulting pages in now.
+        mapping_.advise(0, size_, MADV_SEQUENTIAL);
+        for (const DataExtent& extent : extents_) {
+            mapping_.advise(extent.offset, extent.end - extent.offset, MADV_WILLNEED);
+        }
+    }
+
+    // End of the data extent at offset_. If offset_ is in a hole, it first
+    // moves to the next extent (or the end) and adds the hole to hole_.
+    std::size_t data_end() {
+        while (extent_ < extents_.size() && extents_[extent_].end <= offset_) ++extent_;
+        std::size_t start = extent_ < extents_.size() ? extents_[extent_].offset : size_;
+        if (start > offset_) {
+            hole_ += start - offset_;
+            offset_ = start;
+        }
+        return extent_ < extents_.size() ? extents_[extent_].end : size_;
+    }
+
+    // The rest of the extent ending at `end` has no newline: it is the
+    // final line, or the first piece of a line cut by the hole after it
+    std::optional<LineView> take_rest(std::size_t end) {
+        std::size_t text = end;
+        if (end < size_) {
+            // Zero fill up to the hole is block padding, not text
+            while (text > offset_ && data_[text - 1] == '\0') --text;
+            hole_ += end - text;
+        }
+        std::string_view rest(data_ + offset_, text - offset_);
+        offset_ = end;
+        if (rest.empty()) return std::nullopt;
+
+        LineView view{rest, next_line_number()};
+        continued_ = end < size_;
+        return view;
+    }
+
+    std::size_t next_line_number() {
+        return std::exchange(continued_, false) ? line_number_ : ++line_number_;
+    }
+
+    std::string path_;
+    FileInfo info_;                 // Sniffed once at open
+    FileMapping mapping_;
+    const char* data_ = nullptr;    // First visible byte
+    std::size_t size_ = 0;          // Visible bytes
+    std::size_t offset_ = 0;
+    std::vector<DataExtent> extents_;   // Data in the visible range, relative to data_
+    std::size_t extent_ = 0;        // First extent not yet behind offset_
+    bool show_holes_;
+    std::uint64_t hole_ = 0;        // Hole skipped but not yet handed out
+    bool continued_ = false;        // Next line is the rest of one split by a hole
     std::size_t line_number_;
+    std::size_t base_line_ = 0;     // Lines before the visible range
+    ReaderIndex index_;
+
+    static constexpr std::size_t kScanBatch = 256;
+    static constexpr std::size_t kIndexChunk = 4 * 1024 * 1024;
+};
+
+// Memory-mapped reader for files too large to map whole. A window of
+// kMmapWindow bytes is mapped at the start of the current line and slid
+// forward when a line runs past its end, so lines are still views into
+// the mapping; a line longer than the window doubles it. Pages of the
+// window left behind are dropped with MADV_DONTNEED before it is unmapped.
+// Holes are skipped as in MemoryMappedReader.
+class WindowedMmapReader : public IFileReader {
+public:
+    // Takes ownership of fd, which stays open for remapping
+    WindowedMmapReader(int fd, const std::string& path, std::size_t window, bool show_holes = false)
+        : path_(path), fd_(fd), window_(window), show_holes_(show_holes) {
+        info_ = get_file_info(fd_, path);
+        if (fd_ < 0) {
+            std::cerr << "Warning: Cannot open file: " << path << "\n";
+            return;
+        }
+
+        auto key = file_key(fd_);
+        index_.reset(key);
+        size_ = key ? key->size : 0;
+        extents_ = data_extents(fd_, 0, size_);
+    }
+
+    ~WindowedMmapReader() override {
+        release();
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    WindowedMmapReader(const WindowedMmapReader&) = delete;
+    WindowedMmapReader& operator=(const WindowedMmapReader&) = delete;
+
+    std::optional<LineView> read_line_view() override {
+        while (true) {
+            std::uint64_t end = data_end();
+            if (hole_ > 0) {
+                std::uint64_t size = std::exchange(hole_, 0);
+                if (show_holes_) return LineView{std::string_view(), line_number_, size};
+            }
+            if (offset_ >= size_) {
+                return std::nullopt;
+            }
+
+            std::uint64_t limit = cover(offset_, end);
+            const char* start = at(offset_);
+            std::size_t len = static_cast<std::size_t>(limit - offset_);
+            std::size_t nl = find_newline(start, len);
+            if (nl < len) {
+                offset_ += nl + 1;
+                return LineView{std::string_view(start, nl), next_line_number()};
+            }
+            if (limit < end) {
+                // The line runs past the window
+                slide();
+                continue;
+            }
+            if (auto rest = take_rest(end)) {
+                return rest;
+            }
+        }
+    }
+
+    std::size_t read_lines(std::span<LineView> out) override {
+        // A batch ends where the window would have to move, since that
+        // invalidates the views already handed out
+        std::size_t positions[kScanBatch];
+        std::size_t n = 0;
+        while (n < out.size()) {
+            std::uint64_t end = data_end();
+            if (hole_ > 0) {
+                std::uint64_t size = std::exchange(hole_, 0);
+                if (show_holes_) {
+                    out[n++] = LineView{std::string_view(), line_number_, size};
+                    continue;
+                }
+            }
+            if (offset_ >= size_) break;
+            if (n > 0 && !in_window(offset_)) break;
+
+            std::uint64_t limit = cover(offset_, end);
+            const char* base = at(offset_);
+            std::size_t want = std::min(out.size() - n, kScanBatch);
+            std::size_t found = find_newlines(base, static_cast<std::size_t>(limit - offset_), positions, want);
+
+            std::size_t line_start = 0;
+            for (std::size_t k = 0; k < found; ++k) {
+                out[n++] = LineView{std::string_view(base + line_start, positions[k] - line_start),
+                                    next_line_number()};
+                line_start = positions[k] + 1;
+            }
+            offset_ += line_start;
+
+            if (found < want) {
+                if (limit < end) {
+                    if (n > 0) break;
+                    slide();
+                    continue;
+                }
+                if (auto rest = take_rest(end)) out[n++] = *rest;
+            }
+        }
+        return n;
+    }
+
+    bool seek(std::size_t line_number) override {
+        std::unique_ptr<char[]> chunk;
+        auto checkpoint = index_.locate(line_number, [&](std::uint64_t offset) {
+            if (!chunk) chunk = std::make_unique<char[]>(kIndexChunk);
+            ssize_t n = pread(fd_, chunk.get(), kIndexChunk, static_cast<off_t>(offset));
+            return std::string_view(chunk.get(), n > 0 ? static_cast<std::size_t>(n) : 0);
+        });
+
+        if (line_number < line_number_) {
+            rewind();
+        }
+        if (checkpoint && checkpoint->line > line_number_) {
+            offset_ = checkpoint->offset;
+            line_number_ = checkpoint->line;
+        }
+
+        // Skip the remaining lines a window at a time, never touching holes
+        std::size_t lines = line_number - line_number_;
+        bool partial = false;
+        while (lines > 0) {
+            std::uint64_t end = data_end();
+            if (offset_ >= size_) break;
+            if (!in_window(offset_)) map_window(offset_, window_, 1);
+            std::uint64_t limit = std::min(end, window_end());
+            std::size_t len = static_cast<std::size_t>(limit - offset_);
+            std::size_t pos = skip_lines(at(offset_), len, lines);
+            if (lines == 0) {
+                offset_ += pos;
+                break;
+            }
+            if (len > 0) partial = at(offset_)[len - 1] != '\n';
+            offset_ = limit;
+        }
+
+        // A final line without a trailing newline still counts
+        if (lines == 1 && partial) {
+            lines = 0;
+        }
+        line_number_ = line_number - lines;
+        hole_ = 0;
+        continued_ = false;
+        return lines == 0;
+    }
+
+    FileInfo info() const override {
+        return info_;
+    }
+
+    bool is_large() const override {
+        return true;
+    }
+
+    void rewind() override {
+        offset_ = 0;
+        extent_ = 0;
+        hole_ = 0;
+        continued_ = false;
+        line_number_ = 0;
+    }
+
+private:
+    bool in_window(std::uint64_t offset) const {
+        return mapping_ && offset >= window_start_ && offset < window_end();
+    }
+
+    std::uint64_t window_end() const {
+        return window_start_ + (mapping_ ? mapping_->size() : 0);
+    }
+
+    const char* at(std::uint64_t offset) const {
+        return mapping_->data() + (offset - window_start_);
+    }
+
+    // Map a window at offset if it is not mapped yet; the scannable end
+    // of [offset, end)
+    std::uint64_t cover(std::uint64_t offset, std::uint64_t end) {
+        if (!in_window(offset)) map_window(offset, window_, 1);
+        return std::min(end, window_end());
+    }
+
+    // Move the window to start at the current line, doubling it if the
+    // line already filled a whole window. The new window has to reach
+    // past the old one, or the line would be scanned again forever.
+    void slide() {
+        std::uint64_t needed = window_end() - offset_ + 1;
+        std::uint64_t length = offset_ == window_start_ ? mapping_->size() * 2 : window_;
+        map_window(offset_, std::max(length, needed), needed);
+    }
+
+    // Map `length` bytes at offset, halving down to `needed` bytes when
+    // mmap fails (address space limits). Stops at the end of the file,
+    // which may have shrunk since open; throws if nothing can be mapped
+    // before it.
+    void map_window(std::uint64_t offset, std::uint64_t length, std::uint64_t needed) {
+        release();
+        mapping_ = std::make_unique<FileMapping>();
+        window_start_ = offset;
+        while (true) {
+            mapping_->map(fd_, offset, length);
+            if (mapping_->size() > 0 || length / 2 < needed) break;
+            length /= 2;
+        }
+
+        int error = errno;
+        struct stat st;
+        if (fstat(fd_, &st) == 0) {
+            size_ = std::min<std::uint64_t>(size_, static_cast<std::uint64_t>(st.st_size));
+        }
+        if (offset >= size_) {
+            return;
+        }
+        if (mapping_->size() < std::min(needed, size_ - offset)) {
+            throw std::runtime_error("cannot map " + path_ + ": " + std::strerror(error));
+        }
+
+        std::size_t size = mapping_->size();
+        mapping_->advise(0, size, MADV_SEQUENTIAL);
+        for (const DataExtent& extent : extents_) {
+            std::uint64_t from = std::max(extent.offset, offset);
+            std::uint64_t to = std::min(extent.end, offset + size);
+            if (from < to) {
+                mapping_->advise(static_cast<std::size_t>(from - offset), static_cast<std::size_t>(to - from),
+                                 MADV_WILLNEED);
+            }
+        }
+    }
+
+    // Drop the pages of the window being left before unmapping it
+    void release() {
+        if (mapping_) {
+            mapping_->advise(0, mapping_->size(), MADV_DONTNEED);
+            mapping_.reset();
+        }
+    }
+
+    // End of the data extent at offset_, as in MemoryMappedReader
+    std::uint64_t data_end() {
+        while (extent_ < extents_.size() && extents_[extent_].end <= offset_) ++extent_;
+        std::uint64_t start = extent_ < extents_.size() ? extents_[extent_].offset : size_;
+        if (start > offset_) {
+            hole_ += start - offset_;
+            offset_ = start;
+        }
+        return extent_ < extents_.size() ? std::min(extents_[extent_].end, size_) : size_;
+    }
+
+    // The rest of the extent ending at `end` (all inside the window) has
+    // no newline: the final line or the first piece of one cut by a hole
+    std::optional<LineView> take_rest(std::uint64_t end) {
+        std::uint64_t text = end;
+        if (end < size_) {
+            // Zero fill up to the hole is block padding, not text
+            while (text > offset_ && at(text - 1)[0] == '\0') --text;
+            hole_ += end - text;
+        }
+        std::string_view rest(at(offset_), static_cast<std::size_t>(text - offset_));
+        offset_ = end;
+        if (rest.empty()) return std::nullopt;
+
+        LineView view{rest, next_line_number()};
+        continued_ = end < size_;
+        return view;
+    }
+
+    std::size_t next_line_number() {
+        return std::exchange(continued_, false) ? line_number_ : ++line_number_;
+    }
+
     std::string path_;
+    FileInfo info_;                 // Sniffed once at open
+    int fd_ = -1;
+    std::size_t window_;            // Bytes mapped at a time
+    std::unique_ptr<FileMapping> mapping_;
+    std::uint64_t window_start_ = 0;    // File offset of the mapping's first byte
+    std::uint64_t size_ = 0;
+    std::uint64_t offset_ = 0;
+    std::vector<DataExtent> extents_;   // Data extents of the whole file
+    std::size_t extent_ = 0;        // First extent not yet behind offset_
+    bool show_holes_;
+    std::uint64_t hole_ = 0;        // Hole skipped but not yet handed out
+    bool continued_ = false;        // Next line is the rest of one split by a hole
+    std::size_t line_number_ = 0;
+    ReaderIndex index_;
+
+    static constexpr std::size_t kScanBatch = 256;
+    static constexpr std::size_t kIndexChunk = 4 * 1024 * 1024;
+};
+
+// Restricts another reader to a closed range of lines
+class LineRangeReader : public IFileReader {
+public:
+    LineRangeReader(std::unique_ptr<IFileReader> inner, std::size_t first, std::size_t last)
+        : inner_(std::move(inner)), first_(std::max<std::size_t>(first, 1)), last_(last) {
+        rewind();
+    }
+
+    std::optional<LineView> read_line_view() override {
+        if (line_number_ >= last_) return std::nullopt;
+        auto view = inner_->read_line_view();
+        if (view) line_number_ = view->line_number;
+        return view;
+    }
+
+    std::size_t read_lines(std::span<LineView> out) override {
+        // Never ask for lines past the range, so reading stops right there
+        if (line_number_ >= last_) return 0;
+        std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(out.size(), last_ - line_number_));
+        std::size_t n = inner_->read_lines(out.first(want));
+        if (n > 0) line_number_ = out[n - 1].line_number;
+        return n;
+    }
+
+    bool seek(std::size_t line_number) override {
+        if (line_number < first_ - 1 || line_number > last_) return false;
+        bool ok = inner_->seek(line_number);
+        line_number_ = line_number;
+        return ok;
+    }
+
+    FileInfo info() const override {
+        return inner_->info();
+    }
+
+    bool is_large() const override {
+        return inner_->is_large();
+    }
+
+    void rewind() override {
+        inner_->seek(first_ - 1);
+        line_number_ = first_ - 1;
+    }
+
+private:
+    std::unique_ptr<IFileReader> inner_;
+    std::size_t first_;
+    std::size_t last_;
+    std::size_t line_number_ = 0;  // Last line handed out
 };
 
-std::unique_ptr<IFileReader> create_file_reader(const std::string& path) {
+// Keeps only the final lines of another reader, for inputs that cannot be
+// read backwards. The inner reader is drained on first use.
+class LastLinesReader : public IFileReader {
+public:
+    LastLinesReader(std::unique_ptr<IFileReader> inner, std::size_t count)
+        : inner_(std::move(inner)), count_(count) {
+    }
+
+    std::optional<LineView> read_line_view() override {
+        fill();
+        if (next_ >= size_) return std::nullopt;
+        const Line& line = ring_[(head_ + next_++) % ring_.size()];
+        return LineView{line.text, line.number};
+    }
+
+    bool seek(std::size_t line_number) override {
+        fill();
+        if (size_ == 0) return line_number == 0;
+        std::size_t first = ring_[head_].number - 1;
+        if (line_number < first || line_number > first + size_) return false;
+        next_ = line_number - first;
+        return true;
+    }
+
+    FileInfo info() const override {
+        return inner_->info();
+    }
+
+    bool is_large() const override {
+        return inner_->is_large();
+    }
+
+    void rewind() override {
+        next_ = 0;
+    }
+
+private:
+    struct Line {
+        std::string text;
+        std::size_t number;
+    };
+
+    void fill() {
+        if (filled_) return;
+        filled_ = true;
+        if (count_ == 0) return;
+
+        // Overwrite the oldest slot in place so line buffers get reused
+        ring_.resize(std::min<std::size_t>(count_, kInitialRing));
+        std::array<LineView, kScanBatch> batch;
+        while (std::size_t n = inner_->read_lines(batch)) {
+            for (std::size_t i = 0; i < n; ++i) {
+                if (size_ == ring_.size() && size_ < count_) {
+                    // Grow in order: oldest line at head_ == 0
+                    std::rotate(ring_.begin(), ring_.begin() + head_, ring_.end());
+                    head_ = 0;
+                    ring_.resize(std::min(count_, ring_.size() * 2));
+                }
+                Line& slot = ring_[(head_ + size_) % ring_.size()];
+                slot.text.assign(batch[i].line);
+                slot.number = batch[i].line_number;
+                if (size_ < ring_.size()) {
+                    ++size_;
+                } else {
+                    head_ = (head_ + 1) % ring_.size();
+                }
+            }
+        }
+    }
+
+    std::unique_ptr<IFileReader> inner_;
+    std::size_t count_;
+    std::vector<Line> ring_;
+    std::size_t head_ = 0;   // Oldest kept line
+    std::size_t size_ = 0;   // Lines kept
+    std::size_t next_ = 0;   // Next line to hand out, relative to head_
+    bool filled_ = false;
+
+    static constexpr std::size_t kInitialRing = 1024;
+    static constexpr std::size_t kScanBatch = 256;
+};
+
+// Hands out the lines of a mapped range last to first (tac). Each step
+// scans backwards from the current position only as far as the previous
+// newline, so memory use does not depend on the file size. The kernel's
+// readahead only works forwards, so pages ahead of the cursor (lower
+// addresses) are requested explicitly. Holes are stepped over extent by
+// extent, as the forward readers do, without faulting in their zeros.
+class ReverseReader : public IFileReader {
+public:
+    // Takes ownership of fd. With newlines set (the count before the end of
+    // the range), lines are numbered as in the file, counting down;
+    // otherwise 1, 2, ... in the order they are handed out.
+    ReverseReader(int fd, const std::string& path, std::uint64_t offset, std::uint64_t length,
+                  std::optional<std::size_t> newlines, bool show_holes)
+        : path_(path), show_holes_(show_holes) {
+        mapping_.map(fd, offset, length);
+        info_ = describe_file(fd, path, false);
+        info_.content = sniff_mapping(mapping_.data(), mapping_.size(), fd, offset);
+
+        // Text runs: the data extents less the zero fill before each hole
+        const char* data = mapping_.data();
+        std::size_t size = mapping_.size();
+        for (const DataExtent& extent : data_extents(fd, offset, offset + size)) {
+            std::size_t begin = extent.offset - offset;
+            std::size_t end = extent.end - offset;
+            if (end < size) {
+                while (end > begin && data[end - 1] == '\0') --end;
+            }
+            if (end > begin) runs_.push_back(DataExtent{begin, end});
+        }
+        ::close(fd);
+        mapping_.advise(0, size, MADV_RANDOM);
+
+        // An unterminated final line still counts
+        if (newlines) {
+            last_line_ = *newlines;
+            if (!runs_.empty() && data[runs_.back().end - 1] != '\n') ++*last_line_;
+        }
+        rewind();
+    }
+
+    std::optional<LineView> read_line_view() override {
+        while (true) {
+            if (hole_ > 0) {
+                std::uint64_t size = std::exchange(hole_, 0);
+                if (show_holes_) return LineView{std::string_view(), peek_line_number(), size};
+            }
+            if (run_ == 0) {
+                return std::nullopt;
+            }
+            const DataExtent& run = runs_[run_ - 1];
+            if (run_done_) {
+                leave_run();
+                continue;
+            }
+
+            const char* data = mapping_.data() + run.offset;
+            prefetch(run);
+
+            std::size_t lines = 1;
+            std::size_t start = rskip_lines(data, end_ - run.offset, lines);
+            std::string_view line(data + start, end_ - run.offset - start);
+            if (lines == 0) {
+                end_ = run.offset + start - 1;  // Drop the newline ending the previous line
+            } else {
+                run_done_ = true;               // Reached the start of the run
+            }
+            return LineView{line, next_line_number()};
+        }
+    }
+
+    std::size_t read_lines(std::span<LineView> out) override {
+        std::size_t n = 0;
+        while (n < out.size()) {
+            auto view = read_line_view();
+            if (!view) break;
+            out[n++] = *view;
+        }
+        return n;
+    }
+
+    // Position after the first line_number lines in output order
+    bool seek(std::size_t line_number) override {
+        rewind();
+        while (handed_out_ < line_number) {
+            if (!read_line_view()) return false;
+        }
+        return true;
+    }
+
+    FileInfo info() const override {
+        return info_;
+    }
+
+    bool is_large() const override {
+        return false;
+    }
+
+    void rewind() override {
+        std::size_t size = mapping_.size();
+        run_ = runs_.size();
+        hole_ = size - (runs_.empty() ? 0 : runs_.back().end);
+        handed_out_ = 0;
+        continued_ = false;
+        if (run_ > 0) enter_run(true);
+    }
+
+private:
+    // Start on runs_[run_ - 1]. A trailing newline ends its last line
+    // rather than starting an empty one; without one, that line goes on
+    // after the hole (unless this is the last run), so the piece here
+    // keeps the number of the piece already handed out.
+    void enter_run(bool last) {
+        const DataExtent& run = runs_[run_ - 1];
+        end_ = run.end;
+        if (mapping_.data()[end_ - 1] == '\n') {
+            --end_;
+        } else if (!last) {
+            continued_ = true;
+        }
+        run_done_ = false;
+        prefetched_ = run.end;
+    }
+
+    // Step back over the hole before the current run
+    void leave_run() {
+        std::size_t begin = runs_[run_ - 1].offset;
+        --run_;
+        hole_ += begin - (run_ > 0 ? runs_[run_ - 1].end : 0);
+        if (run_ > 0) enter_run(false);
+    }
+
+    std::size_t line_number(std::size_t handed_out) const {
+        return last_line_ ? *last_line_ + 1 - handed_out : handed_out;
+    }
+
+    std::size_t next_line_number() {
+        if (!std::exchange(continued_, false)) ++handed_out_;
+        return line_number(handed_out_);
+    }
+
+    // A hole marker carries the number of the line before the hole, which
+    // is the next one handed out
+    std::size_t peek_line_number() const {
+        return line_number(continued_ ? handed_out_ : handed_out_ + 1);
+    }
+
+    // Keep at least half a window below the cursor requested from disk,
+    // without reaching back past the start of the run into a hole
+    void prefetch(const DataExtent& run) {
+        if (prefetched_ <= run.offset || end_ >= prefetched_ + kPrefetch / 2) return;
+        std::size_t from = prefetched_ > run.offset + kPrefetch ? prefetched_ - kPrefetch : run.offset;
+        mapping_.advise(from, prefetched_ - from, MADV_WILLNEED);
+        prefetched_ = from;
+    }
+
+    std::string path_;
+    FileInfo info_;                 // Sniffed once at open
+    FileMapping mapping_;
+    std::vector<DataExtent> runs_;  // Text in the mapping, in file order
+    std::optional<std::size_t> last_line_;
+    bool show_holes_ = false;
+    std::size_t run_ = 0;           // Current run, plus one (0 when all are done)
+    bool run_done_ = true;          // Reached the start of the current run
+    std::size_t end_ = 0;           // End of the next line to hand out
+    std::uint64_t hole_ = 0;        // Hole bytes passed over, not yet reported
+    bool continued_ = false;        // Next piece is the earlier part of the last line
+    std::size_t handed_out_ = 0;    // Lines started so far
+    std::size_t prefetched_ = 0;    // Lowest offset already requested
+
+    static constexpr std::size_t kPrefetch = 4 * 1024 * 1024;
+};
+
+std::unique_ptr<IFileReader> create_file_reader(const std::string& path, const ReaderOptions& options) {
+    // One descriptor for the plan and the reader: a FIFO opened twice
+    // would lose its writer between the two
+    int fd = (path == "-") ? fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0)
+                           : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (options.no_cache) {
+        // No readahead from the probes and the sniff either
+        posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+    }
+    ReaderPlan plan = plan_reader(fd, options.random_access);
+    Compression type = Compression::None;
     if (path == "-") {
-        // Stdin - always use streaming
-        return std::make_unique<StreamingFileReader>("/dev/stdin");
+        // Stdin is read from where the shell left it, whatever it is
+        plan.strategy = ReaderStrategy::Buffered;
+        plan.reason = "stdin";
+    } else if (plan.kind == FileKind::Regular) {
+        // Compressed input, recognised by its magic bytes, decodes on a
+        // worker thread; lines are split from the decoded blocks
+        type = detect_compression(fd);
+        if (type != Compression::None) {
+            plan.strategy = ReaderStrategy::Decompress;
+            plan.reason = compression_name(type);
+        }
+    }
+
+    // --no-cache reads regular files and block devices through the async
+    // reader, with O_DIRECT where the filesystem allows it, so the page
+    // cache is left as it was
+    CachePolicy cache = CachePolicy::Normal;
+    int direct_fd = -1;
+    if (options.no_cache && plan.strategy != ReaderStrategy::Decompress &&
+        (plan.kind == FileKind::Regular || plan.kind == FileKind::BlockDevice)) {
+        direct_fd = open_direct(fd);
+        cache = direct_fd >= 0 ? CachePolicy::Direct : CachePolicy::DropBehind;
+        plan.strategy = ReaderStrategy::Async;
+        plan.reason = direct_fd >= 0 ? "--no-cache, O_DIRECT" : "--no-cache, pages dropped behind the reader";
+    }
+    if (options.plan) *options.plan = plan;
+
+    try {
+        switch (plan.strategy) {
+            case ReaderStrategy::Decompress:
+                return std::make_unique<AsyncFileReader>(
+                    path, fd, make_decompressor(fd, type, kDecompressBlock, kDecompressDepth));
+            case ReaderStrategy::Mmap:
+                return std::make_unique<MemoryMappedReader>(fd, path, options.show_holes);
+            case ReaderStrategy::WindowedMmap:
+                return std::make_unique<WindowedMmapReader>(fd, path, kMmapWindow, options.show_holes);
+            case ReaderStrategy::Async:
+                return std::make_unique<AsyncFileReader>(fd, path, plan.size, options.buffer_size,
+                                                         options.show_holes, cache, direct_fd);
+            case ReaderStrategy::Buffered:
+            default:
+                return std::make_unique<StreamingFileReader>(fd, path, options.buffer_size, options.show_holes);
+        }
+    } catch (...) {
+        if (fd >= 0) ::close(fd);
+        if (direct_fd >= 0) ::close(direct_fd);
+        throw;
+    }
+}
+
+std::unique_ptr<IFileReader> limit_lines(
+    std::unique_ptr<IFileReader> reader, std::size_t first, std::size_t last) {
+    return std::make_unique<LineRangeReader>(std::move(reader), first, last);
+}
+
+namespace {
+
+// Number of lines that end before byte `offset`: nearest indexed line
+// start, then a newline count over the rest
+std::size_t lines_before(int fd, std::uint64_t offset) {
+    if (offset == 0) return 0;
+
+    auto chunk = std::make_unique<char[]>(kSpoolChunk);
+    auto source = [&](std::uint64_t at) {
+        ssize_t n = pread(fd, chunk.get(), kSpoolChunk, static_cast<off_t>(at));
+        return std::string_view(chunk.get(), n > 0 ? static_cast<std::size_t>(n) : 0);
+    };
+
+    ReaderIndex index;
+    index.reset(file_key(fd));
+    std::size_t lines = 0;
+    std::uint64_t at = 0;
+    if (auto checkpoint = index.locate_offset(offset, source)) {
+        lines = checkpoint->line;
+        at = checkpoint->offset;
     }
+    // Holes hold no newlines; only the data extents are read
+    for (const DataExtent& extent : data_extents(fd, at, offset)) {
+        for (at = extent.offset; at < extent.end;) {
+            std::string_view data = source(at);
+            if (data.empty()) return lines;
+            std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(data.size(), extent.end - at));
+            lines += count_newlines(data.data(), n);
+            at += n;
+        }
+    }
+    return lines;
+}
+
+}  // namespace
+
+std::unique_ptr<IFileReader> create_byte_range_reader(
+    const std::string& path, std::uint64_t offset, std::uint64_t length, bool number_lines,
+    bool show_holes) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Warning: Cannot open file: " << path << "\n";
+        return std::make_unique<MemoryMappedReader>(-1, path);
+    }
+    // A pipe, device or procfs file maps as empty or one page; its bytes
+    // have no offsets to window
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || is_virtual_fs(fd)) {
+        ::close(fd);
+        throw std::runtime_error("--bytes needs a regular file");
+    }
+
+    std::size_t first_line = number_lines ? lines_before(fd, offset) : 0;
+    return std::make_unique<MemoryMappedReader>(fd, path, offset, length, first_line, show_holes);
+}
+
+std::unique_ptr<IFileReader> last_lines(std::unique_ptr<IFileReader> reader, std::size_t count) {
+    return std::make_unique<LastLinesReader>(std::move(reader), count);
+}
+
+namespace {
+
+// Offset just past the lines-th newline before `upto`, reading backwards
+// from there in kTailChunk blocks; 0 if the file has fewer. Holes hold no
+// newlines, so only the data extents are read.
+std::uint64_t walk_back(int fd, const std::vector<DataExtent>& extents, std::uint64_t upto,
+                        std::size_t lines, char* chunk) {
+    for (auto extent = extents.rbegin(); extent != extents.rend(); ++extent) {
+        for (std::uint64_t end = std::min(extent->end, upto); end > extent->offset;) {
+            std::uint64_t start = std::max(extent->offset, end > kTailChunk ? end - kTailChunk : 0);
+            ssize_t n = pread(fd, chunk, end - start, static_cast<off_t>(start));
+            if (n <= 0) return 0;
+            std::size_t pos = rskip_lines(chunk, static_cast<std::size_t>(n), lines);
+            if (lines == 0) return start + pos;
+            end = start;
+        }
+    }
+    return 0;
+}
 
-    auto info = get_file_info(path);
+}  // namespace
 
-    switch (info.size_category) {
-        case FileSize::Small:
-            return std::make_unique<MemoryMappedReader>(path);
-        case FileSize::Medium:
-        case FileSize::Large:
-        default:
-            return std::make_unique<StreamingFileReader>(path);
+std::optional<TailRange> find_tail(const std::string& path, std::size_t lines) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return std::nullopt;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    // A hole at the end of a preallocated log is not part of its last
+    // line, and neither is the zero fill of the block before it
+    auto extents = data_extents(fd, 0, static_cast<std::uint64_t>(st.st_size));
+    std::uint64_t size = extents.empty() ? 0 : extents.back().end;
+
+    auto chunk = std::make_unique<char[]>(kTailChunk);
+    if (size < static_cast<std::uint64_t>(st.st_size)) {
+        std::uint64_t start = std::max(extents.back().offset, size > kTailChunk ? size - kTailChunk : 0);
+        ssize_t n = pread(fd, chunk.get(), size - start, static_cast<off_t>(start));
+        while (n > 0 && chunk[n - 1] == '\0') --n;
+        if (n >= 0) {
+            size = start + static_cast<std::uint64_t>(n);
+            extents.back().end = size;
+        }
+    }
+
+    TailRange range;
+    range.size = size;
+    range.end = walk_back(fd, extents, size, 1, chunk.get());
+
+    // An unterminated final line counts as one of the lines; the others
+    // end at or before the newline just ahead of range.end
+    std::size_t complete = lines;
+    if (lines > 0 && range.end < size) --complete;
+    range.offset = lines == 0 ? size : range.end;
+    if (complete > 0 && range.end > 0) {
+        range.offset = walk_back(fd, extents, range.end - 1, complete, chunk.get());
     }
+
+    ::close(fd);
+    return range;
+}
+
+namespace {
+
+bool write_all(int fd, const char* data, std::size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Unlinked temporary file under $TMPDIR (or /tmp)
+int open_spill_file() {
+    const char* dir = std::getenv("TMPDIR");
+    if (!dir || !*dir) dir = "/tmp";
+
+    int fd = ::open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0) return fd;
+
+    // Filesystems without O_TMPFILE
+    std::string templ = std::string(dir) + "/fastcat-spool-XXXXXX";
+    fd = mkostemp(templ.data(), O_CLOEXEC);
+    if (fd >= 0) unlink(templ.c_str());
+    return fd;
+}
+
+// Move everything written to `from` so far into `to`
+bool copy_spool(int from, int to) {
+    auto buffer = std::make_unique<char[]>(kSpoolChunk);
+    off_t offset = 0;
+    while (true) {
+        ssize_t n = pread(from, buffer.get(), kSpoolChunk, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        if (n == 0) return true;
+        if (!write_all(to, buffer.get(), static_cast<std::size_t>(n))) return false;
+        offset += n;
+    }
+}
+
+// Copy all of fd into a memfd, moving to an unlinked file on disk once
+// more than memory_limit bytes have arrived
+int spool_to_file(int fd, std::size_t memory_limit) {
+    int spool = memfd_create("fastcat-spool", MFD_CLOEXEC);
+    bool spilled = false;
+    if (spool < 0) {
+        spool = open_spill_file();
+        spilled = true;
+    }
+    if (spool < 0) {
+        throw std::runtime_error("cannot create spool file");
+    }
+
+    auto buffer = std::make_unique<char[]>(kSpoolChunk);
+    std::size_t total = 0;
+    while (true) {
+        ssize_t n = ::read(fd, buffer.get(), kSpoolChunk);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            int error = errno;
+            ::close(spool);
+            throw std::runtime_error(std::string("read failed: ") + std::strerror(error));
+        }
+        if (n == 0) break;
+
+        total += static_cast<std::size_t>(n);
+        if (!spilled && total > memory_limit) {
+            // Past the memory budget: continue on disk
+            int file = open_spill_file();
+            if (file >= 0 && copy_spool(spool, file)) {
+                ::close(spool);
+                spool = file;
+                spilled = true;
+            } else if (file >= 0) {
+                ::close(file);
+            }
+        }
+        if (!write_all(spool, buffer.get(), static_cast<std::size_t>(n))) {
+            ::close(spool);
+            throw std::runtime_error(std::string("spool write failed: ") + std::strerror(errno));
+        }
+    }
+
+    return spool;
+}
+
+}  // namespace
+
+std::unique_ptr<IFileReader> spool_input(int fd, std::size_t memory_limit) {
+    return std::make_unique<MemoryMappedReader>(spool_to_file(fd, memory_limit), "-");
+}
+
+std::unique_ptr<IFileReader> create_reverse_reader(
+    const std::string& path, std::uint64_t offset, std::uint64_t length, bool number_lines,
+    bool show_holes) {
+    bool is_stdin = path == "-";
+    int source = is_stdin ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    // Regular files can be mapped as they are; pipes, devices and procfs
+    // files (whose size says nothing) are spooled first, named or on stdin
+    int fd;
+    struct stat source_st;
+    if (fstat(source, &source_st) == 0 && S_ISREG(source_st.st_mode) && !is_virtual_fs(source)) {
+        fd = is_stdin ? fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0) : source;
+    } else {
+        try {
+            fd = spool_to_file(source, kDefaultSpoolMemory);
+        } catch (...) {
+            if (!is_stdin) ::close(source);
+            throw;
+        }
+        if (!is_stdin) ::close(source);
+    }
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+
+    // Numbering from the end needs the line count up to the end of the range
+    std::optional<std::size_t> newlines;
+    if (number_lines) {
+        struct stat st;
+        std::uint64_t size = fstat(fd, &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+        newlines = lines_before(fd, offset + std::min(length, size - std::min(offset, size)));
+    }
+
+    return std::make_unique<ReverseReader>(fd, path, offset, length, newlines, show_holes);
 }
 
 }  // namespace fastcat
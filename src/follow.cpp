@@ -0,0 +1,194 @@
+#include "follow.h"
+#include "line_scan.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+// Events on the file itself: growth, truncation, unlink, rename
+constexpr std::uint32_t kFileEvents = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+
+// Events on its directory: a new file appearing under our name
+constexpr std::uint32_t kDirEvents = IN_CREATE | IN_MOVED_TO;
+
+// pread size when catching up with appended data, and about the most
+// wait() hands out at once
+constexpr std::size_t kReadChunk = 256 * 1024;
+
+std::string parent_dir(const std::string& path) {
+    auto slash = path.rfind('/');
+    if (slash == std::string::npos) return ".";
+    if (slash == 0) return "/";
+    return path.substr(0, slash);
+}
+
+std::string base_name(const std::string& path) {
+    auto slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+}  // namespace
+
+FileFollower::FileFollower(const std::string& path, std::uint64_t offset)
+    : path_(path), name_(base_name(path)), offset_(offset) {
+    inotify_ = inotify_init1(IN_CLOEXEC);
+    if (inotify_ < 0) {
+        throw std::runtime_error(std::string("inotify_init failed: ") + std::strerror(errno));
+    }
+
+    // Without the directory watch rotation goes unnoticed, but appends
+    // to the current file are still followed
+    dir_watch_ = inotify_add_watch(inotify_, parent_dir(path_).c_str(), kDirEvents);
+
+    if (!open_file()) {
+        ::close(inotify_);
+        throw std::runtime_error("Cannot follow file: " + path_);
+    }
+}
+
+FileFollower::~FileFollower() {
+    if (fd_ >= 0) ::close(fd_);
+    if (inotify_ >= 0) ::close(inotify_);
+}
+
+bool FileFollower::open_file() {
+    int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    // Watch through the descriptor so the watch is on the file we have
+    // open even if the path is replaced in between
+    std::string proc = "/proc/self/fd/" + std::to_string(fd);
+    int watch = inotify_add_watch(inotify_, proc.c_str(), kFileEvents);
+    if (watch < 0) {
+        watch = inotify_add_watch(inotify_, path_.c_str(), kFileEvents);
+    }
+    if (watch < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    if (fd_ >= 0) {
+        if (file_watch_ >= 0 && file_watch_ != watch) {
+            inotify_rm_watch(inotify_, file_watch_);
+        }
+        ::close(fd_);
+    }
+    fd_ = fd;
+    file_watch_ = watch;
+    return true;
+}
+
+void FileFollower::read_available(std::vector<std::string>& lines) {
+    struct stat st;
+    if (fstat(fd_, &st) == 0 && static_cast<std::uint64_t>(st.st_size) < offset_) {
+        std::cerr << "fastcat: " << path_ << ": file truncated\n";
+        offset_ = 0;
+        carry_.clear();
+    }
+
+    auto chunk = std::make_unique<char[]>(kReadChunk);
+    for (;;) {
+        ssize_t n = pread(fd_, chunk.get(), kReadChunk, static_cast<off_t>(offset_));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        offset_ += static_cast<std::uint64_t>(n);
+
+        const char* data = chunk.get();
+        std::size_t len = static_cast<std::size_t>(n);
+        std::size_t start = 0;
+        while (start < len) {
+            std::size_t pos = start + find_newline(data + start, len - start);
+            if (pos == len) {
+                carry_.append(data + start, len - start);
+                break;
+            }
+            if (carry_.empty()) {
+                lines.emplace_back(data + start, pos - start);
+            } else {
+                carry_.append(data + start, pos - start);
+                lines.push_back(std::move(carry_));
+                carry_.clear();
+            }
+            start = pos + 1;
+        }
+
+        // One chunk per batch, so a large append or a fast writer is
+        // handed out as it is read rather than held in memory whole; the
+        // next wait() picks up from offset_
+        if (!lines.empty()) break;
+    }
+}
+
+bool FileFollower::switch_file(std::vector<std::string>& lines) {
+    struct stat current, named;
+    if (stat(path_.c_str(), &named) != 0) {
+        return false;  // Nothing there yet, keep waiting
+    }
+    if (fstat(fd_, &current) == 0 && current.st_dev == named.st_dev &&
+        current.st_ino == named.st_ino) {
+        replaced_ = false;  // Still the same file
+        return false;
+    }
+    if (!open_file()) {
+        return false;
+    }
+
+    // The old file is finished; its unterminated last line is complete
+    if (!carry_.empty()) {
+        lines.push_back(std::move(carry_));
+        carry_.clear();
+    }
+    std::cerr << "fastcat: " << path_ << " has been replaced; following new file\n";
+    offset_ = 0;
+    replaced_ = false;
+    return true;
+}
+
+bool FileFollower::read_events() {
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t n = ::read(inotify_, buf, sizeof(buf));
+    if (n < 0) {
+        return errno == EINTR;
+    }
+
+    for (ssize_t i = 0; i < n;) {
+        auto* event = reinterpret_cast<const struct inotify_event*>(buf + i);
+        if (event->wd == file_watch_) {
+            if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) {
+                replaced_ = true;
+            } else if (event->mask & IN_ATTRIB) {
+                // Unlinked while we still hold it open
+                struct stat st;
+                if (fstat(fd_, &st) == 0 && st.st_nlink == 0) replaced_ = true;
+            }
+        } else if (event->wd == dir_watch_ && event->len > 0 && name_ == event->name) {
+            replaced_ = true;
+        }
+        i += sizeof(struct inotify_event) + event->len;
+    }
+    return true;
+}
+
+bool FileFollower::wait(std::vector<std::string>& lines) {
+    lines.clear();
+    for (;;) {
+        // Drain the current file before considering a replacement
+        read_available(lines);
+        if (lines.empty() && replaced_ && switch_file(lines)) {
+            read_available(lines);
+        }
+        if (!lines.empty()) return true;
+        if (!read_events()) return false;
+    }
+}
+
+}  // namespace fastcat
@@ -0,0 +1,225 @@
+#include "frame_index.h"
+#include "index_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+constexpr char kFrameMagic[8] = {'F', 'C', 'F', 'I', 'D', 'X', '1', '\n'};
+
+// Fixed-size header of a cached frame index; per-frame varints follow
+struct FrameHeader {
+    char magic[8];
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+    std::uint64_t count;
+    std::uint64_t counted;
+};
+
+std::uint32_t le32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t le_n(const unsigned char* p, int n) {
+    std::uint64_t value = 0;
+    for (int i = n - 1; i >= 0; --i) value = (value << 8) | p[i];
+    return value;
+}
+
+bool read_exact(int fd, void* buf, std::size_t len, std::uint64_t offset) {
+    return pread(fd, buf, len, static_cast<off_t>(offset)) == static_cast<ssize_t>(len);
+}
+
+// BGZF: gzip members carrying their own size in a "BC" extra subfield and
+// the decompressed size in the trailer
+bool scan_bgzf(int fd, std::uint64_t file_size, std::vector<FrameIndex::Frame>& frames) {
+    std::uint64_t offset = 0;
+    std::uint64_t raw = 0;
+    while (offset < file_size) {
+        unsigned char h[18];
+        if (!read_exact(fd, h, sizeof(h), offset)) return false;
+        if (h[0] != 0x1f || h[1] != 0x8b || h[2] != 8 || !(h[3] & 4)) return false;
+        // BGZF writes exactly one subfield: 'B' 'C', length 2, BSIZE
+        if (h[10] != 6 || h[11] != 0 || h[12] != 'B' || h[13] != 'C' || h[14] != 2 || h[15] != 0) {
+            return false;
+        }
+        std::uint64_t size = static_cast<std::uint64_t>(h[16] | (h[17] << 8)) + 1;
+        if (size < 26 || offset + size > file_size) return false;
+
+        unsigned char trailer[4];
+        if (!read_exact(fd, trailer, sizeof(trailer), offset + size - 4)) return false;
+        std::uint64_t raw_size = le32(trailer);
+
+        // Empty blocks (the EOF marker) carry nothing
+        if (raw_size > 0) frames.push_back({offset, size, raw, raw_size});
+        raw += raw_size;
+        offset += size;
+    }
+    return true;
+}
+
+// zstd: frame header, then blocks with 3-byte headers, then an optional
+// checksum. Skippable frames (pzstd, seekable format) are stepped over.
+bool scan_zstd(int fd, std::uint64_t file_size, std::vector<FrameIndex::Frame>& frames) {
+    std::uint64_t offset = 0;
+    std::uint64_t raw = 0;
+    while (offset < file_size) {
+        unsigned char h[18];
+        std::size_t have = static_cast<std::size_t>(std::min<std::uint64_t>(sizeof(h), file_size - offset));
+        if (have < 8 || !read_exact(fd, h, have, offset)) return false;
+
+        std::uint32_t magic = le32(h);
+        if ((magic & 0xfffffff0u) == 0x184d2a50u) {
+            offset += 8 + static_cast<std::uint64_t>(le32(h + 4));
+            continue;
+        }
+        if (magic != 0xfd2fb528u) return false;
+
+        unsigned char fhd = h[4];
+        int fcs_flag = fhd >> 6;
+        bool single_segment = fhd & 0x20;
+        bool checksum = fhd & 0x04;
+        int dict_bytes = (fhd & 3) == 3 ? 4 : (fhd & 3);
+        int fcs_bytes = fcs_flag == 0 ? (single_segment ? 1 : 0) : (1 << fcs_flag);
+        if (fcs_bytes == 0) return false;  // Size not recorded
+
+        std::size_t pos = 5 + (single_segment ? 0 : 1) + dict_bytes;
+        if (pos + fcs_bytes > have) return false;
+        std::uint64_t raw_size = le_n(h + pos, fcs_bytes) + (fcs_bytes == 2 ? 256 : 0);
+
+        // Walk the blocks to find where the frame ends
+        std::uint64_t at = offset + pos + fcs_bytes;
+        bool last = false;
+        while (!last) {
+            unsigned char b[3];
+            if (!read_exact(fd, b, sizeof(b), at)) return false;
+            std::uint32_t header = b[0] | (b[1] << 8) | (b[2] << 16);
+            last = header & 1;
+            int type = (header >> 1) & 3;
+            std::uint64_t block_size = header >> 3;
+            if (type == 3) return false;
+            at += 3 + (type == 1 ? 1 : block_size);  // RLE blocks store one byte
+            if (at > file_size) return false;
+        }
+        if (checksum) at += 4;
+        if (at > file_size) return false;
+
+        if (raw_size > 0) frames.push_back({offset, at - offset, raw, raw_size});
+        raw += raw_size;
+        offset = at;
+    }
+    return true;
+}
+
+}  // namespace
+
+std::optional<FrameIndex> FrameIndex::scan(int fd, Compression type) {
+    auto key = file_key(fd);
+    if (!key) return std::nullopt;
+
+    FrameIndex index;
+    bool ok = false;
+    if (type == Compression::Gzip) {
+        ok = scan_bgzf(fd, key->size, index.frames_);
+    } else if (type == Compression::Zstd) {
+        ok = scan_zstd(fd, key->size, index.frames_);
+    }
+    if (!ok || index.frames_.size() < 2) return std::nullopt;
+    return index;
+}
+
+std::uint64_t FrameIndex::raw_size() const {
+    return frames_.empty() ? 0 : frames_.back().raw_offset + frames_.back().raw_size;
+}
+
+std::size_t FrameIndex::find(std::uint64_t raw_offset) const {
+    auto it = std::upper_bound(frames_.begin(), frames_.end(), raw_offset,
+                               [](std::uint64_t value, const Frame& frame) { return value < frame.raw_offset; });
+    return it == frames_.begin() ? 0 : static_cast<std::size_t>(it - frames_.begin()) - 1;
+}
+
+void FrameIndex::add_count(std::size_t newlines) {
+    if (counted() < frames_.size()) {
+        newlines_before_.push_back(newlines_before_.back() + newlines);
+    }
+}
+
+std::size_t FrameIndex::frame_for_line(std::size_t line) const {
+    // newlines_before_ is non-decreasing; find the last entry below `line`
+    auto it = std::lower_bound(newlines_before_.begin(), newlines_before_.end(), line);
+    std::size_t k = it == newlines_before_.begin() ? 0 : static_cast<std::size_t>(it - newlines_before_.begin()) - 1;
+    return std::min(k, frames_.size() - 1);
+}
+
+std::optional<FrameIndex> FrameIndex::load_cached(const FileKey& key) {
+    auto cached = detail::read_cache_file(detail::cache_path(key, ".frames"));
+    if (!cached) return std::nullopt;
+    const std::string& data = *cached;
+
+    FrameHeader header;
+    if (data.size() < sizeof(header)) return std::nullopt;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, kFrameMagic, sizeof(kFrameMagic)) != 0 ||
+        header.device != key.device || header.inode != key.inode ||
+        header.size != key.size || header.mtime_ns != key.mtime_ns ||
+        header.counted > header.count) {
+        return std::nullopt;
+    }
+
+    FrameIndex index;
+    const char* p = data.data() + sizeof(header);
+    const char* end = data.data() + data.size();
+    std::uint64_t offset = 0;
+    std::uint64_t raw = 0;
+    for (std::uint64_t i = 0; i < header.count; ++i) {
+        std::uint64_t gap, size, raw_size;
+        if (!detail::get_varint(p, end, gap) || !detail::get_varint(p, end, size) ||
+            !detail::get_varint(p, end, raw_size)) {
+            return std::nullopt;
+        }
+        offset += gap;
+        index.frames_.push_back({offset, size, raw, raw_size});
+        offset += size;
+        raw += raw_size;
+    }
+    for (std::uint64_t i = 0; i < header.counted; ++i) {
+        std::uint64_t newlines;
+        if (!detail::get_varint(p, end, newlines)) return std::nullopt;
+        index.add_count(newlines);
+    }
+    if (offset > key.size || index.frames_.size() < 2) return std::nullopt;
+    return index;
+}
+
+bool FrameIndex::store_cached(const FileKey& key) const {
+    FrameHeader header{};
+    std::memcpy(header.magic, kFrameMagic, sizeof(kFrameMagic));
+    header.device = key.device;
+    header.inode = key.inode;
+    header.size = key.size;
+    header.mtime_ns = key.mtime_ns;
+    header.count = frames_.size();
+    header.counted = counted();
+
+    // Frames as (gap since previous frame, size, raw size): the gaps are
+    // skipped frames and are usually zero
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::uint64_t end = 0;
+    for (const Frame& frame : frames_) {
+        detail::put_varint(data, frame.offset - end);
+        detail::put_varint(data, frame.size);
+        detail::put_varint(data, frame.raw_size);
+        end = frame.offset + frame.size;
+    }
+    for (std::size_t k = 0; k < counted(); ++k) {
+        detail::put_varint(data, newlines_before_[k + 1] - newlines_before_[k]);
+    }
+    return detail::write_cache_file(detail::cache_path(key, ".frames"), data);
+}
+
+}  // namespace fastcat
@@ -0,0 +1,30 @@
+#ifndef FASTCAT_INDEX_CACHE_H
+#define FASTCAT_INDEX_CACHE_H
+
+// Private helpers for the on-disk index caches (line and frame indexes).
+// Entries live under $XDG_CACHE_HOME/fastcat (or ~/.cache/fastcat), one
+// file per device/inode with a per-kind suffix.
+
+#include "line_index.h"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace fastcat::detail {
+
+// Cache file for `key`, e.g. "<dev>-<ino>.idx"; empty if there is no home
+std::filesystem::path cache_path(const FileKey& key, const char* suffix);
+
+// Whole cache file, or std::nullopt if it cannot be read
+std::optional<std::string> read_cache_file(const std::filesystem::path& path);
+
+// Write aside and rename so concurrent readers never see a torn file
+bool write_cache_file(const std::filesystem::path& path, const std::string& data);
+
+void put_varint(std::string& out, std::uint64_t value);
+bool get_varint(const char*& p, const char* end, std::uint64_t& value);
+
+}  // namespace fastcat::detail
+
+#endif  // FASTCAT_INDEX_CACHE_H
@@ -0,0 +1,269 @@
+#include "line_index.h"
+#include "line_scan.h"
+#include "index_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kIndexMagic[8] = {'F', 'C', 'L', 'I', 'D', 'X', '1', '\n'};
+
+// Fixed-size header of a cached index; checkpoint deltas follow as varints
+struct IndexHeader {
+    char magic[8];
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+    std::uint64_t stride;
+    std::uint64_t scanned_bytes;
+    std::uint64_t scanned_lines;
+    std::uint64_t pending_lines;
+    std::uint64_t complete;
+    std::uint64_t count;
+};
+
+fs::path cache_dir() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return fs::path(xdg) / "fastcat";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return fs::path(home) / ".cache" / "fastcat";
+    }
+    return {};
+}
+
+}  // namespace
+
+namespace detail {
+
+fs::path cache_path(const FileKey& key, const char* suffix) {
+    fs::path dir = cache_dir();
+    if (dir.empty()) return {};
+    char name[64];
+    snprintf(name, sizeof(name), "%llx-%llx%s",
+             static_cast<unsigned long long>(key.device),
+             static_cast<unsigned long long>(key.inode), suffix);
+    return dir / name;
+}
+
+std::optional<std::string> read_cache_file(const fs::path& path) {
+    if (path.empty()) return std::nullopt;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::nullopt;
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+bool write_cache_file(const fs::path& path, const std::string& data) {
+    if (path.empty()) return false;
+
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    if (ec) return false;
+
+    fs::path tmp = path;
+    // Unique per thread too: files are rendered, and indexed, in parallel
+    static std::atomic<unsigned> sequence{0};
+    tmp += ".tmp." + std::to_string(getpid()) + "." + std::to_string(sequence++);
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+            out.close();
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+void put_varint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool get_varint(const char*& p, const char* end, std::uint64_t& value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        auto byte = static_cast<unsigned char>(*p++);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+}  // namespace detail
+
+std::optional<FileKey> file_key(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return std::nullopt;
+    }
+    return FileKey{
+        static_cast<std::uint64_t>(st.st_dev),
+        static_cast<std::uint64_t>(st.st_ino),
+        static_cast<std::uint64_t>(st.st_size),
+        static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec,
+    };
+}
+
+LineIndex::LineIndex(std::size_t stride)
+    : stride_(stride > 0 ? stride : kDefaultStride)
+    , offsets_{0}
+    , scanned_bytes_(0)
+    , scanned_lines_(0)
+    , pending_lines_(0)
+    , complete_(false)
+{
+}
+
+LineIndex::Checkpoint LineIndex::lookup(std::size_t line) const {
+    std::size_t k = std::min(line / stride_, offsets_.size() - 1);
+    return Checkpoint{k * stride_, offsets_[k]};
+}
+
+LineIndex::Checkpoint LineIndex::lookup_offset(std::uint64_t offset) const {
+    // offsets_ is sorted and starts at 0, so the predecessor always exists
+    auto it = std::upper_bound(offsets_.begin(), offsets_.end(), offset);
+    std::size_t k = static_cast<std::size_t>(it - offsets_.begin()) - 1;
+    return Checkpoint{k * stride_, offsets_[k]};
+}
+
+void LineIndex::extend(const char* data, std::size_t len) {
+    std::size_t pos = 0;
+    while (pos < len) {
+        std::size_t need = stride_ - pending_lines_;
+        std::size_t lines = need;
+        std::size_t next = skip_lines(data + pos, len - pos, lines);
+
+        std::size_t seen = need - lines;
+        scanned_lines_ += seen;
+        pending_lines_ += seen;
+
+        if (lines > 0) break;  // Chunk exhausted before the next checkpoint
+
+        pos += next;
+        offsets_.push_back(scanned_bytes_ + pos);
+        pending_lines_ = 0;
+    }
+    scanned_bytes_ += len;
+}
+
+bool LineIndex::cover(std::size_t line, const ChunkSource& source) {
+    bool grew = false;
+    while (!complete_ && scanned_lines_ < line) {
+        std::string_view chunk = source(scanned_bytes_);
+        if (chunk.empty()) {
+            complete_ = true;
+            break;
+        }
+        extend(chunk.data(), chunk.size());
+        grew = true;
+    }
+    return grew;
+}
+
+bool LineIndex::cover_offset(std::uint64_t offset, const ChunkSource& source) {
+    bool grew = false;
+    while (!complete_ && scanned_bytes_ < offset) {
+        std::string_view chunk = source(scanned_bytes_);
+        if (chunk.empty()) {
+            complete_ = true;
+            break;
+        }
+        extend(chunk.data(), chunk.size());
+        grew = true;
+    }
+    return grew;
+}
+
+std::optional<LineIndex> LineIndex::load_cached(const FileKey& key) {
+    auto cached = detail::read_cache_file(detail::cache_path(key, ".idx"));
+    if (!cached) return std::nullopt;
+    const std::string& data = *cached;
+
+    IndexHeader header;
+    if (data.size() < sizeof(header)) return std::nullopt;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+        header.device != key.device || header.inode != key.inode ||
+        header.size != key.size || header.mtime_ns != key.mtime_ns ||
+        header.stride == 0 || header.scanned_bytes > key.size ||
+        header.count > data.size() - sizeof(header) ||
+        header.count != header.scanned_lines / header.stride + 1 ||
+        header.pending_lines != header.scanned_lines % header.stride) {
+        // Each offset takes at least one varint byte, so a larger count
+        // is corrupt and must not size the reserve below; and there is one
+        // checkpoint per stride lines scanned, plus line 0
+        return std::nullopt;
+    }
+
+    LineIndex index(header.stride);
+    index.offsets_.clear();
+    index.offsets_.reserve(header.count);
+
+    const char* p = data.data() + sizeof(header);
+    const char* end = data.data() + data.size();
+    std::uint64_t offset = 0;
+    for (std::uint64_t i = 0; i < header.count; ++i) {
+        std::uint64_t delta;
+        if (!detail::get_varint(p, end, delta)) return std::nullopt;
+        // Line starts only grow, and lie within what was scanned: anything
+        // else would send seeks to arbitrary offsets
+        if ((i > 0 && delta == 0) || delta > header.scanned_bytes - offset) return std::nullopt;
+        offset += delta;
+        index.offsets_.push_back(offset);
+    }
+    if (index.offsets_.empty() || index.offsets_[0] != 0) return std::nullopt;
+
+    index.scanned_bytes_ = header.scanned_bytes;
+    index.scanned_lines_ = header.scanned_lines;
+    index.pending_lines_ = header.pending_lines;
+    index.complete_ = header.complete != 0;
+    return index;
+}
+
+bool LineIndex::store_cached(const FileKey& key) const {
+    IndexHeader header{};
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.device = key.device;
+    header.inode = key.inode;
+    header.size = key.size;
+    header.mtime_ns = key.mtime_ns;
+    header.stride = stride_;
+    header.scanned_bytes = scanned_bytes_;
+    header.scanned_lines = scanned_lines_;
+    header.pending_lines = pending_lines_;
+    header.complete = complete_;
+    header.count = offsets_.size();
+
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::uint64_t prev = 0;
+    for (std::uint64_t offset : offsets_) {
+        detail::put_varint(data, offset - prev);
+        prev = offset;
+    }
+    return detail::write_cache_file(detail::cache_path(key, ".idx"), data);
+}
+
+}  // namespace fastcat
@@ -0,0 +1,114 @@
+#include "line_scan.h"
+#include "line_scan_impl.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace fastcat {
+
+namespace detail {
+
+namespace {
+
+struct ScalarMask {
+    static std::uint64_t block(const char* p) {
+        std::uint64_t m = 0;
+        for (std::size_t i = 0; i < kBlock; ++i) {
+            m |= static_cast<std::uint64_t>(p[i] == '\n') << i;
+        }
+        return m;
+    }
+
+    static ByteMasks classes(const char* p) {
+        ByteMasks m{};
+        for (std::size_t i = 0; i < kBlock; ++i) {
+            auto c = static_cast<unsigned char>(p[i]);
+            std::uint64_t bit = std::uint64_t{1} << i;
+            if (c == '\n') m.newline |= bit;
+            else if (c == '\r') m.cr |= bit;
+            else if (c == 0) m.nul |= bit;
+            else if (c >= 0x80) m.high |= bit;
+            else if (c < 0x20 && c != '\t' && c != '\f' && c != 0x1b) m.control |= bit;
+        }
+        return m;
+    }
+};
+
+}  // namespace
+
+const LineScanOps kScalarLineScan = make_line_scan_ops<ScalarMask>("scalar");
+
+}  // namespace detail
+
+namespace {
+
+using detail::LineScanOps;
+
+const LineScanOps& select_line_scan() {
+    // FASTCAT_SIMD can only lower the level the CPU supports, never raise it
+    const char* forced = std::getenv("FASTCAT_SIMD");
+    auto allowed = [forced](const char* name) {
+        if (!forced) return true;
+        static const char* const order[] = {"scalar", "sse2", "avx2", "avx512"};
+        int want = -1, have = -1;
+        for (int i = 0; i < 4; ++i) {
+            if (std::strcmp(forced, order[i]) == 0) want = i;
+            if (std::strcmp(name, order[i]) == 0) have = i;
+        }
+        return want < 0 || have <= want;
+    };
+
+#ifdef FASTCAT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw") && allowed("avx512")) {
+        return detail::kAvx512LineScan;
+    }
+    if (__builtin_cpu_supports("avx2") && allowed("avx2")) {
+        return detail::kAvx2LineScan;
+    }
+    if (__builtin_cpu_supports("sse2") && allowed("sse2")) {
+        return detail::kSse2LineScan;
+    }
+#else
+    (void)allowed;
+#endif
+    return detail::kScalarLineScan;
+}
+
+const LineScanOps& line_scan() {
+    static const LineScanOps& ops = select_line_scan();
+    return ops;
+}
+
+}  // namespace
+
+std::size_t find_newline(const char* data, std::size_t len) {
+    return line_scan().find(data, len);
+}
+
+std::size_t find_newlines(const char* data, std::size_t len, std::size_t* out, std::size_t max) {
+    return line_scan().find_all(data, len, out, max);
+}
+
+std::size_t count_newlines(const char* data, std::size_t len) {
+    return line_scan().count(data, len);
+}
+
+std::size_t skip_lines(const char* data, std::size_t len, std::size_t& lines) {
+    return line_scan().skip(data, len, lines);
+}
+
+std::size_t rskip_lines(const char* data, std::size_t len, std::size_t& lines) {
+    return line_scan().rskip(data, len, lines);
+}
+
+ByteStats byte_stats(const char* data, std::size_t len) {
+    ByteStats stats;
+    line_scan().stats(data, len, stats);
+    return stats;
+}
+
+const char* line_scan_isa() {
+    return line_scan().name;
+}
+
+}  // namespace fastcat
@@ -0,0 +1,49 @@
+#include "line_scan_impl.h"
+#include <immintrin.h>
+
+namespace fastcat::detail {
+
+namespace {
+
+struct Avx2Mask {
+    static std::uint64_t block(const char* p) {
+        const __m256i nl = _mm256_set1_epi8('\n');
+        std::uint64_t lo = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), nl)));
+        std::uint64_t hi = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), nl)));
+        return lo | (hi << 32);
+    }
+
+    static ByteMasks classes(const char* p) {
+        ByteMasks m{};
+        for (int k = 0; k < 2; ++k) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k));
+            auto bits = [k](__m256i v) {
+                return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(v))) << (32 * k);
+            };
+            std::uint64_t nl = bits(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')));
+            std::uint64_t cr = bits(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r')));
+            std::uint64_t nul = bits(_mm256_cmpeq_epi8(x, _mm256_setzero_si256()));
+            std::uint64_t text = bits(_mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t')),
+                                _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\f'))),
+                _mm256_cmpeq_epi8(x, _mm256_set1_epi8(0x1b))));
+            std::uint64_t high = bits(x);
+            // Signed compare: bytes >= 0x80 are "below" 0x20 too
+            std::uint64_t low = bits(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), x));
+            m.newline |= nl;
+            m.cr |= cr;
+            m.nul |= nul;
+            m.high |= high;
+            m.control |= low & ~high & ~(nl | cr | nul | text);
+        }
+        return m;
+    }
+};
+
+}  // namespace
+
+const LineScanOps kAvx2LineScan = make_line_scan_ops<Avx2Mask>("avx2");
+
+}  // namespace fastcat::detail
@@ -0,0 +1,34 @@
+#include "line_scan_impl.h"
+#include <immintrin.h>
+
+namespace fastcat::detail {
+
+namespace {
+
+struct Avx512Mask {
+    static std::uint64_t block(const char* p) {
+        return _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p), _mm512_set1_epi8('\n'));
+    }
+
+    static ByteMasks classes(const char* p) {
+        __m512i x = _mm512_loadu_si512(p);
+        ByteMasks m;
+        m.newline = _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('\n'));
+        m.cr = _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('\r'));
+        m.nul = _mm512_cmpeq_epi8_mask(x, _mm512_setzero_si512());
+        m.high = _mm512_movepi8_mask(x);
+        std::uint64_t text = _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('\t')) |
+                             _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('\f')) |
+                             _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8(0x1b));
+        // Unsigned compare, so bytes >= 0x80 are not "below" 0x20
+        std::uint64_t low = _mm512_cmplt_epu8_mask(x, _mm512_set1_epi8(0x20));
+        m.control = low & ~(m.newline | m.cr | m.nul | text);
+        return m;
+    }
+};
+
+}  // namespace
+
+const LineScanOps kAvx512LineScan = make_line_scan_ops<Avx512Mask>("avx512");
+
+}  // namespace fastcat::detail
@@ -0,0 +1,195 @@
+#ifndef FASTCAT_LINE_SCAN_IMPL_H
+#define FASTCAT_LINE_SCAN_IMPL_H
+
+// Private to the line_scan*.cpp translation units. Each ISA variant is
+// compiled in its own file with matching -m flags and instantiates the
+// generic loops below with a 64-byte block mask primitive.
+
+#include "line_scan.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace fastcat::detail {
+
+struct LineScanOps {
+    const char* name;
+    std::size_t (*find)(const char*, std::size_t);
+    std::size_t (*find_all)(const char*, std::size_t, std::size_t*, std::size_t);
+    std::size_t (*count)(const char*, std::size_t);
+    std::size_t (*skip)(const char*, std::size_t, std::size_t&);
+    std::size_t (*rskip)(const char*, std::size_t, std::size_t&);
+    void (*stats)(const char*, std::size_t, ByteStats&);
+};
+
+// Only built on x86 (FASTCAT_X86_SIMD); declared unconditionally so the
+// definitions always get external linkage
+extern const LineScanOps kScalarLineScan;
+extern const LineScanOps kSse2LineScan;
+extern const LineScanOps kAvx2LineScan;
+extern const LineScanOps kAvx512LineScan;
+
+// Internal linkage so code built with wider ISA flags never gets merged
+// with (and picked over) the baseline copies at link time
+namespace {
+
+constexpr std::size_t kBlock = 64;
+
+// Per-class bitmaps of one 64-byte block, bit i for p[i]
+struct ByteMasks {
+    std::uint64_t newline;  // '\n'
+    std::uint64_t cr;       // '\r'
+    std::uint64_t nul;      // '\0'
+    std::uint64_t control;  // Other bytes below 0x20 except '\t', '\f' and ESC
+    std::uint64_t high;     // Bytes >= 0x80
+};
+
+// Mask::block(p) returns bit i set iff p[i] == '\n', for i in [0, 64);
+// Mask::classes(p) returns the ByteMasks of the block
+template <typename Mask>
+inline std::uint64_t tail_mask(const char* p, std::size_t n) {
+    // Zero padding never matches, so a partial block reuses the full kernel
+    alignas(64) char buf[kBlock] = {};
+    __builtin_memcpy(buf, p, n);
+    return Mask::block(buf);
+}
+
+template <typename Mask>
+std::size_t scan_find(const char* data, std::size_t len) {
+    std::size_t i = 0;
+    for (; i + kBlock <= len; i += kBlock) {
+        std::uint64_t m = Mask::block(data + i);
+        if (m) return i + __builtin_ctzll(m);
+    }
+    if (i < len) {
+        std::uint64_t m = tail_mask<Mask>(data + i, len - i);
+        if (m) return i + __builtin_ctzll(m);
+    }
+    return len;
+}
+
+template <typename Mask>
+std::size_t scan_find_all(const char* data, std::size_t len, std::size_t* out, std::size_t max) {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < len && n < max; i += kBlock) {
+        std::uint64_t m = (i + kBlock <= len) ? Mask::block(data + i)
+                                              : tail_mask<Mask>(data + i, len - i);
+        while (m && n < max) {
+            out[n++] = i + __builtin_ctzll(m);
+            m &= m - 1;
+        }
+    }
+    return n;
+}
+
+template <typename Mask>
+std::size_t scan_count(const char* data, std::size_t len) {
+    std::size_t count = 0;
+    std::size_t i = 0;
+    for (; i + kBlock <= len; i += kBlock) {
+        count += __builtin_popcountll(Mask::block(data + i));
+    }
+    if (i < len) {
+        count += __builtin_popcountll(tail_mask<Mask>(data + i, len - i));
+    }
+    return count;
+}
+
+template <typename Mask>
+std::size_t scan_skip(const char* data, std::size_t len, std::size_t& lines) {
+    if (lines == 0) return 0;
+    for (std::size_t i = 0; i < len; i += kBlock) {
+        std::uint64_t m = (i + kBlock <= len) ? Mask::block(data + i)
+                                              : tail_mask<Mask>(data + i, len - i);
+        std::size_t c = __builtin_popcountll(m);
+        if (c < lines) {
+            lines -= c;
+            continue;
+        }
+        // Drop the lowest lines-1 set bits; the next one is our target
+        for (std::size_t k = 1; k < lines; ++k) m &= m - 1;
+        lines = 0;
+        return i + __builtin_ctzll(m) + 1;
+    }
+    return len;
+}
+
+template <typename Mask>
+std::size_t scan_rskip(const char* data, std::size_t len, std::size_t& lines) {
+    if (lines == 0) return len;
+    // Walk 64-byte blocks aligned to the end of the buffer, last one first
+    for (std::size_t end = len; end > 0;) {
+        std::size_t start = end >= kBlock ? end - kBlock : 0;
+        std::uint64_t m = (end - start == kBlock) ? Mask::block(data + start)
+                                                  : tail_mask<Mask>(data + start, end - start);
+        std::size_t c = __builtin_popcountll(m);
+        if (c < lines) {
+            lines -= c;
+            end = start;
+            continue;
+        }
+        // Drop the highest lines-1 set bits; the next one is our target
+        for (std::size_t k = 1; k < lines; ++k) m &= ~(std::uint64_t{1} << (63 - __builtin_clzll(m)));
+        lines = 0;
+        return start + (63 - __builtin_clzll(m)) + 1;
+    }
+    return 0;
+}
+
+template <typename Mask>
+void scan_stats(const char* data, std::size_t len, ByteStats& stats) {
+    std::uint64_t cr_carry = 0;  // Last byte of the previous block was '\r'
+    std::size_t line_start = 0;
+    std::size_t cr = 0;
+    for (std::size_t i = 0; i < len; i += kBlock) {
+        ByteMasks m;
+        if (i + kBlock <= len) {
+            m = Mask::classes(data + i);
+        } else {
+            // Zero padding would count as NUL, so clip every class
+            alignas(64) char buf[kBlock] = {};
+            __builtin_memcpy(buf, data + i, len - i);
+            m = Mask::classes(buf);
+            std::uint64_t valid = (std::uint64_t{1} << (len - i)) - 1;
+            m.newline &= valid;
+            m.cr &= valid;
+            m.nul &= valid;
+            m.control &= valid;
+            m.high &= valid;
+        }
+
+        stats.newlines += __builtin_popcountll(m.newline);
+        stats.crlf += __builtin_popcountll(m.newline & ((m.cr << 1) | cr_carry));
+        cr += __builtin_popcountll(m.cr);
+        stats.nul += __builtin_popcountll(m.nul);
+        stats.control += __builtin_popcountll(m.control);
+        stats.high += __builtin_popcountll(m.high);
+        cr_carry = m.cr >> 63;
+
+        for (std::uint64_t nl = m.newline; nl; nl &= nl - 1) {
+            std::size_t pos = i + __builtin_ctzll(nl);
+            if (pos - line_start > stats.max_line) stats.max_line = pos - line_start;
+            line_start = pos + 1;
+        }
+    }
+    if (len - line_start > stats.max_line) stats.max_line = len - line_start;
+    stats.lone_cr += cr - stats.crlf;
+}
+
+template <typename Mask>
+constexpr LineScanOps make_line_scan_ops(const char* name) {
+    return LineScanOps{
+        name,
+        &scan_find<Mask>,
+        &scan_find_all<Mask>,
+        &scan_count<Mask>,
+        &scan_skip<Mask>,
+        &scan_rskip<Mask>,
+        &scan_stats<Mask>,
+    };
+}
+
+}  // namespace
+
+}  // namespace fastcat::detail
+
+#endif  // FASTCAT_LINE_SCAN_IMPL_H
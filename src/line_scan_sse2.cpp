@@ -0,0 +1,52 @@
+#include "line_scan_impl.h"
+#include <emmintrin.h>
+
+namespace fastcat::detail {
+
+namespace {
+
+struct Sse2Mask {
+    static std::uint64_t block(const char* p) {
+        const __m128i nl = _mm_set1_epi8('\n');
+        std::uint64_t m0 = static_cast<std::uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), nl)));
+        std::uint64_t m1 = static_cast<std::uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)), nl)));
+        std::uint64_t m2 = static_cast<std::uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)), nl)));
+        std::uint64_t m3 = static_cast<std::uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)), nl)));
+        return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+    }
+
+    static ByteMasks classes(const char* p) {
+        ByteMasks m{};
+        for (int k = 0; k < 4; ++k) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+            auto bits = [k](__m128i v) {
+                return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(v))) << (16 * k);
+            };
+            std::uint64_t nl = bits(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+            std::uint64_t cr = bits(_mm_cmpeq_epi8(x, _mm_set1_epi8('\r')));
+            std::uint64_t nul = bits(_mm_cmpeq_epi8(x, _mm_setzero_si128()));
+            std::uint64_t text = bits(_mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\f'))),
+                _mm_cmpeq_epi8(x, _mm_set1_epi8(0x1b))));
+            std::uint64_t high = bits(x);
+            // Signed compare: bytes >= 0x80 are "below" 0x20 too
+            std::uint64_t low = bits(_mm_cmplt_epi8(x, _mm_set1_epi8(0x20)));
+            m.newline |= nl;
+            m.cr |= cr;
+            m.nul |= nul;
+            m.high |= high;
+            m.control |= low & ~high & ~(nl | cr | nul | text);
+        }
+        return m;
+    }
+};
+
+}  // namespace
+
+const LineScanOps kSse2LineScan = make_line_scan_ops<Sse2Mask>("sse2");
+
+}  // namespace fastcat::detail
@@ -4,76 +4,435 @@
 #include "csv_formatter.h"
 #include "theme.h"
 #include "pager.h"
-
+#include "passthrough.h"
+#include "follow.h"
+#include "decompress.h"
+#include "line_scan.h"
+#include "file_prefetch.h"
+#include "ordered_render.h"
+#include "dir_walk.h"
+#include "output_sink.h"
+#include "style_runs.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 namespace fastcat {
 
+// Lines requested from the reader per read_lines() batch
+constexpr std::size_t kLineBatch = 256;
+
+// Files up to this size are rendered whole on one thread, several files at
+// a time; larger ones are split into chunks of kRenderChunk input bytes
+// that are highlighted in parallel
+constexpr std::uint64_t kParallelFileLimit = 16 * 1024 * 1024;
+constexpr std::size_t kRenderChunk = 1024 * 1024;
+
+// `line` as it is printed, without the newline: numbered if asked and
+// highlighted when there is a syntax to highlight it with
+std::string render_line(
+    std::string_view line,
+    std::size_t line_num,
+    const std::optional<SyntaxDefinition>& syntax,
+    bool line_numbers
+) {
+    char num_buf[32];
+    std::size_t num_len = 0;
+    if (line_numbers) {
+        num_len = snprintf(num_buf, sizeof(num_buf), "%6zu  ", line_num);
+    }
+
+    std::string output(num_buf, num_len);
+    if (!syntax || syntax->name == "csv") {
+        output.append(line);
+        return output;
+    }
+    auto tokens = highlight_line(std::string(line), *syntax, false);
+    if (minimal_sgr()) {
+        append_styled(tokens, output);
+    } else {
+        append_styled_full(tokens, output);
+    }
+    return output;
+}
+
 // Output styled line with optional syntax highlighting
 void output_styled_line(
-    const std::string& line,
+    std::string_view line,
     std::size_t line_num,
     const std::optional<SyntaxDefinition>& syntax,
     const std::optional<Theme>& theme,
     bool line_numbers,
     bool use_pager,
-    Pager* pager
+    Pager* pager,
+    OutputSink& out
 ) {
-    std::string output;
-
-    if (line_numbers) {
-        char buf[32];
-        snprintf(buf, sizeof(buf), "%6zu  ", line_num);
-        output += buf;
-    }
-
     if (!syntax || syntax->name == "csv") {
-        // No syntax highlighting, just output the line
-        output += line;
+        // No syntax highlighting, write the view straight through
         if (use_pager && pager) {
-            pager->output_line(output);
+            // The pager numbers the line itself
+            pager->output_line_number(line, line_num);
         } else {
-            std::cout << output << "\n";
+            char num_buf[32];
+            std::size_t num_len = 0;
+            if (line_numbers) {
+                num_len = snprintf(num_buf, sizeof(num_buf), "%6zu  ", line_num);
+            }
+            out.write(num_buf, num_len);
+            out.write(line);
+            out.put('\n');
         }
         return;
     }
 
-    auto tokens = highlight_line(line, *syntax, false);
+    std::string output = render_line(line, line_num, syntax, line_numbers);
+    if (use_pager && pager) {
+        pager->output_line(output);
+    } else {
+        out << output << "\n";
+    }
+}
+
+// Human-readable byte count, e.g. "4.0 GiB" (exact below 1 KiB)
+std::string format_size(std::uint64_t size) {
+    static const char* const units[] = {"B", "KiB", "MiB", "GiB", "TiB", "PiB"};
+    double value = static_cast<double>(size);
+    std::size_t unit = 0;
+    // Step up a unit early so rounding never prints "1024.0 MiB"
+    while (value >= 1023.95 && unit + 1 < std::size(units)) {
+        value /= 1024;
+        ++unit;
+    }
 
-    for (const auto& token : tokens) {
-        if (!token.color.empty()) {
-            output += token.color;
-        }
-        if (token.bold) {
-            output += Color::BOLD;
-        }
-        output += token.text;
-        output += Color::RESET;
+    char buf[32];
+    if (unit == 0) {
+        snprintf(buf, sizeof(buf), "%llu B", static_cast<unsigned long long>(size));
+    } else {
+        snprintf(buf, sizeof(buf), "%.1f %s", value, units[unit]);
     }
+    return buf;
+}
+
+// Stand-in for a skipped hole in a sparse file, e.g. "[hole: 4.0 GiB]"
+std::string hole_marker(std::uint64_t size, bool line_numbers) {
+    return std::string(line_numbers ? "        " : "") + "[hole: " + format_size(size) + "]";
+}
 
+void output_hole_marker(std::uint64_t size, bool line_numbers, bool use_pager, Pager* pager,
+                        OutputSink& out) {
+    std::string marker = hole_marker(size, line_numbers);
     if (use_pager && pager) {
-        pager->output_line(output);
+        pager->output_line(marker);
     } else {
-        std::cout << output << "\n";
+        out << marker << '\n';
     }
 }
 
-void process_file(
-    const std::string& path,
-    const Arguments& args,
-    bool is_tty
+// What --stats reports about one input, printed to stderr (never mixed
+// with the output) once the input is done with, however that happens.
+// `reader` names the strategy; when create_file_reader() did not pick it
+// (ranges, kernel copy) the plan describes the file and gives the reason.
+struct StatsReport {
+    bool enabled = false;
+    std::string path;
+    std::string reader;
+    ReaderPlan plan;
+    std::optional<FileInfo> info;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    StatsReport(bool enabled, const std::string& path) : enabled(enabled), path(path) {}
+    StatsReport(const StatsReport&) = delete;
+    StatsReport& operator=(const StatsReport&) = delete;
+
+    ~StatsReport() {
+        if (enabled && std::uncaught_exceptions() == 0) print();
+    }
+
+    // Describe the file without choosing its reader
+    void describe(const char* how, const char* why) {
+        if (!enabled) return;
+        // Non-blocking so a FIFO, already drained, does not wait for a writer
+        int fd = path == "-" ? fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0)
+                             : ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        plan = plan_reader(fd, false);
+        if (fd >= 0) ::close(fd);
+        reader = how;
+        plan.reason = why;
+    }
+
+    void print() const {
+        std::string file = file_kind_name(plan.kind);
+        std::uint64_t size = plan.size ? plan.size : (info ? info->size : 0);
+        file += ", " + format_size(size);
+        if (plan.resident_percent >= 0) {
+            file += ", " + std::to_string(plan.resident_percent) + "% in page cache";
+        }
+        if (plan.available_memory) {
+            file += ", " + format_size(plan.available_memory) + " memory available";
+        }
+
+        std::cerr << "fastcat: " << path << "\n"
+                  << "  reader   " << reader;
+        if (*plan.reason) std::cerr << " (" << plan.reason << ")";
+        std::cerr << "\n  file     " << file << "\n";
+
+        if (info && info->content.sniffed) {
+            const ContentInfo& content = info->content;
+            std::cerr << "  content  " << (content.binary ? "binary" : "text")
+                      << ", " << encoding_name(content.encoding)
+                      << (content.bom_length ? " with BOM" : "")
+                      << ", " << line_ending_name(content.line_ending) << " line endings"
+                      << ", lines avg " << content.avg_line_length << " / max " << content.max_line_length;
+            if (!content.syntax.empty()) std::cerr << ", looks like " << content.syntax;
+            std::cerr << "\n";
+        }
+
+        char elapsed[32];
+        snprintf(elapsed, sizeof(elapsed), "%.3f ms",
+                 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+        std::cerr << "  scan     " << line_scan_isa() << "\n"
+                  << "  time     " << elapsed << "\n";
+    }
+};
+
+// Emit every line of `reader`, highlighted as requested. With
+// flush_batches set (pipes, terminals) output is flushed whenever the
+// reader has handed over everything it currently holds, so slow producers
+// such as `tail -f` are echoed as their data arrives.
+// Returns the number of the last line emitted (0 if none).
+std::size_t render_lines(
+    IFileReader& reader,
+    const std::optional<SyntaxDefinition>& syntax,
+    const std::optional<Theme>& theme,
+    bool line_numbers,
+    bool use_pager,
+    Pager* pager,
+    bool flush_batches,
+    OutputSink& out
 ) {
-    auto reader = create_file_reader(path);
-    auto file_info = reader->info();
+    std::array<LineView, kLineBatch> batch;
+    std::size_t last = 0;
+
+    // Lines with nothing to highlight go to the sink a batch per call, as
+    // number, line and newline pieces pointing into the reader's buffer
+    bool gather = (!syntax || syntax->name == "csv") && !use_pager;
+    std::vector<struct iovec> pieces;
+    std::vector<std::array<char, 32>> numbers(gather && line_numbers ? kLineBatch : 0);
+    std::vector<std::string> rendered;
+
+    while (std::size_t n = reader.read_lines(batch)) {
+        if (gather) {
+            pieces.clear();
+            for (std::size_t i = 0; i < n; ++i) {
+                if (batch[i].hole) {
+                    out.write(pieces);
+                    pieces.clear();
+                    output_hole_marker(batch[i].hole, line_numbers, false, nullptr, out);
+                    continue;
+                }
+                if (line_numbers) {
+                    int len = snprintf(numbers[i].data(), numbers[i].size(), "%6zu  ", batch[i].line_number);
+                    pieces.push_back({numbers[i].data(), static_cast<std::size_t>(len)});
+                }
+                pieces.push_back({const_cast<char*>(batch[i].line.data()), batch[i].line.size()});
+                pieces.push_back({const_cast<char*>("\n"), 1});
+            }
+            out.write(pieces);
+        } else if (use_pager && pager) {
+            // Rendered a batch at a time, so the pager writes each page's
+            // worth in one go instead of a line per call
+            rendered.resize(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                rendered[i] = batch[i].hole ? hole_marker(batch[i].hole, line_numbers)
+                                            : render_line(batch[i].line, batch[i].line_number, syntax,
+                                                          line_numbers);
+            }
+            pager->output_lines(std::span<const std::string>(rendered));
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                if (batch[i].hole) {
+                    output_hole_marker(batch[i].hole, line_numbers, use_pager, pager, out);
+                    continue;
+                }
+                output_styled_line(batch[i].line, batch[i].line_number, syntax, theme,
+                                   line_numbers, use_pager, pager, out);
+            }
+        }
+        last = batch[n - 1].line_number;
+        if (flush_batches) {
+            out.flush();
+        }
+    }
+    return last;
+}
 
-    // Determine if we should use pager
-    bool use_pager = args.pager || (is_tty && file_info.size_category == FileSize::Large);
+// Lines copied out of the reader for a render thread, which may run after
+// the reader has moved on
+struct LineChunk {
+    struct Line {
+        std::size_t offset;
+        std::size_t length;
+        std::size_t line_number;
+        std::uint64_t hole;
+    };
+    std::string text;
+    std::vector<Line> lines;
+};
+
+// render_lines() for large files: lines are copied into chunks of about
+// kRenderChunk bytes, highlighted on `threads` threads and written in
+// order. highlight_line() carries no state from one line to the next, so
+// a chunk may start at any line and the output is the same as
+// render_lines() gives; a lexer that did (block comments, strings across
+// lines) would have to cut chunks only where its state is reset.
+// Returns the number of the last line emitted (0 if none).
+std::size_t render_chunked(
+    IFileReader& reader,
+    const std::optional<SyntaxDefinition>& syntax,
+    const std::optional<Theme>& theme,
+    bool line_numbers,
+    std::size_t threads,
+    OutputSink& out
+) {
+    OrderedTaskQueue queue(threads);
+    auto submit = [&](std::shared_ptr<LineChunk> chunk) {
+        queue.submit([chunk, &syntax, &theme, line_numbers](std::string& output) {
+            OutputSink rendered(output);
+            for (const auto& line : chunk->lines) {
+                if (line.hole) {
+                    output_hole_marker(line.hole, line_numbers, false, nullptr, rendered);
+                    continue;
+                }
+                output_styled_line(std::string_view(chunk->text).substr(line.offset, line.length),
+                                   line.line_number, syntax, theme, line_numbers, false, nullptr, rendered);
+            }
+        });
+    };
+    auto write_oldest = [&] {
+        out.write(queue.take());
+    };
+
+    std::array<LineView, kLineBatch> batch;
+    std::size_t last = 0;
+    auto chunk = std::make_shared<LineChunk>();
+    while (std::size_t n = reader.read_lines(batch)) {
+        for (std::size_t i = 0; i < n; ++i) {
+            chunk->lines.push_back({chunk->text.size(), batch[i].line.size(), batch[i].line_number, batch[i].hole});
+            chunk->text.append(batch[i].line);
+        }
+        last = batch[n - 1].line_number;
+        if (chunk->text.size() >= kRenderChunk) {
+            // Two chunks per thread keep every thread busy while one is written
+            if (queue.pending() >= threads * 2) write_oldest();
+            submit(std::move(chunk));
+            chunk = std::make_shared<LineChunk>();
+        }
+    }
+    if (!chunk->lines.empty()) submit(std::move(chunk));
+    while (queue.pending()) write_oldest();
+    return last;
+}
+
+// Emit `reader` with markdown tables aligned. Only the rows of the table
+// currently being read are held in memory; other lines pass straight through.
+void render_markdown(IFileReader& reader, bool flush_batches, OutputSink& out) {
+    std::vector<std::string> table_lines;
+    bool in_table = false;
+
+    auto flush_table = [&]() {
+        // Format and output the table
+        out.write_lines(format_md_table(table_lines));
+        table_lines.clear();
+        in_table = false;
+    };
+
+    std::array<LineView, kLineBatch> batch;
+    while (std::size_t n = reader.read_lines(batch)) {
+        for (std::size_t i = 0; i < n; ++i) {
+            std::string_view line = batch[i].line;
+            if (batch[i].hole) {
+                if (in_table) flush_table();
+                output_hole_marker(batch[i].hole, false, false, nullptr, out);
+                continue;
+            }
+            if (in_table) {
+                // Collect consecutive table lines (skipping separators)
+                if (looks_like_md_table(line)) {
+                    if (!is_md_table_separator(line)) {
+                        table_lines.emplace_back(line);
+                    }
+                    continue;
+                }
+                flush_table();
+            }
+
+            if (looks_like_md_table(line) && !is_md_table_separator(line)) {
+                in_table = true;
+                table_lines.emplace_back(line);
+            } else {
+                // Non-table line
+                out << line << "\n";
+            }
+        }
+        if (flush_batches) {
+            out.flush();
+        }
+    }
 
-    // Get syntax definition
+    if (in_table) {
+        flush_table();
+    }
+}
+
+// True when nothing would change the bytes on their way out, so the input
+// can be copied verbatim instead of being split into lines
+bool is_plain_output(const Arguments& args, const std::optional<SyntaxDefinition>& syntax) {
+    // The kernel copy goes through the page cache
+    return !args.lines && !args.bytes && !args.tail && !args.follow && !args.reverse && !args.show_holes &&
+           !args.no_cache &&
+           !syntax && !args.line_numbers && !args.align_csv &&
+           !args.align_md_table && !args.rainbow_csv;
+}
+
+// Whether the content sniff takes the file at path for binary
+bool sniffs_binary(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd < 0) return false;  // Left for the copy to report
+    bool binary = get_file_info(fd, path).content.binary;
+    ::close(fd);
+    return binary;
+}
+
+// plan_reader() for a path before any reader opens it ("-" is stdin).
+// The O_PATH descriptor reads nothing, so a FIFO keeps its writer and
+// its data for the real open.
+ReaderPlan plan_path(const std::string& path) {
+    int fd = path == "-" ? fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0)
+                         : ::open(path.c_str(), O_PATH | O_CLOEXEC);
+    ReaderPlan plan = plan_reader(fd, false);
+    if (fd >= 0) ::close(fd);
+    return plan;
+}
+
+// Syntax for a file: as given by --syntax, else from its name
+std::optional<SyntaxDefinition> file_syntax(const std::string& path, const Arguments& args, bool compressed) {
     std::optional<SyntaxDefinition> syntax;
     if (args.syntax) {
         // Use specified syntax - create syntax definition from name
@@ -84,19 +443,152 @@ void process_file(
         if (syntax->name == "py") syntax->name = "python";
         if (syntax->name == "cpp" || syntax->name == "c") syntax->name = "cpp";
     } else {
-        syntax = detect_syntax(path);
+        // app.json.gz is highlighted as JSON
+        syntax = detect_syntax(compressed ? strip_compression_suffix(path) : path);
+    }
+    return syntax;
+}
+
+void process_file(
+    const std::string& path,
+    const Arguments& args,
+    bool is_tty,
+    OutputSink& out,
+    bool skip_binary = false
+) {
+    struct stat st;
+    if (path != "-" && stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        throw std::runtime_error("Is a directory (use -r to read the files under it)");
+    }
+
+    StatsReport stats(args.stats, path);
+    bool compressed = detect_compression(path) != Compression::None;
+    if (compressed && (args.bytes || args.reverse || args.follow)) {
+        throw std::runtime_error("--bytes, --reverse and --follow need uncompressed input");
+    }
+
+    std::optional<SyntaxDefinition> syntax = file_syntax(path, args, compressed);
+
+    // Plain cat: let the kernel move the bytes unless the pager needs lines
+    // (or the output is not stdout itself)
+    if (is_plain_output(args, syntax) && !args.pager && !compressed && out.fd() == STDOUT_FILENO &&
+        !(is_tty && get_file_info(path).size_category == FileSize::Large)) {
+        // No reader sniffs the file here; the sniff leaves its first pages
+        // in the cache for the copy
+        if (skip_binary && sniffs_binary(path)) {
+            return;
+        }
+        out.flush();
+        if (copy_file_raw(path, STDOUT_FILENO)) {
+            stats.describe("kernel copy", "plain output");
+            return;
+        }
+    }
+
+    // CSV tables have no place for hole markers
+    bool csv = args.rainbow_csv || args.align_csv || (syntax && syntax->name == "csv");
+    bool show_holes = args.show_holes && !csv;
+
+    // Byte windows are read forwards, or backwards with --reverse
+    auto open_range = [&](std::uint64_t offset, std::uint64_t length) {
+        return args.reverse ? create_reverse_reader(path, offset, length, args.line_numbers,
+                                                    show_holes)
+                            : create_byte_range_reader(path, offset, length, args.line_numbers,
+                                                       show_holes);
+    };
+
+    // Byte offsets and scanning back from EOF only work in a regular file
+    // whose size is its content. Pipes, devices, procfs files and
+    // compressed input are read through and their last lines kept, or
+    // spooled for --reverse; --bytes refuses them.
+    ReaderPlan plan;
+    if (!compressed && (args.bytes || args.tail || args.follow || args.reverse)) {
+        plan = plan_path(path);
+    }
+    bool seekable = !compressed && plan.kind == FileKind::Regular;
+    bool from_end = (args.tail || args.follow) && seekable;
+
+    std::unique_ptr<IFileReader> reader;
+    std::optional<std::uint64_t> follow_from;
+    if (args.bytes) {
+        if (path == "-") {
+            throw std::runtime_error("--bytes needs a regular file, not stdin");
+        }
+        if (!seekable && !args.reverse) {
+            throw std::runtime_error(std::string("--bytes needs a regular file, not a ") +
+                                     file_kind_name(plan.kind));
+        }
+        reader = open_range(args.bytes->offset, args.bytes->length);
+        stats.describe(args.reverse ? "reverse mmap scan" : "mmap window",
+                       seekable ? "--bytes" : "--bytes, spooled first");
+    } else if (from_end) {
+        // Scan back from EOF instead of reading the whole file
+        auto tail = find_tail(path, args.tail.value_or(0));
+        if (!tail) {
+            throw std::runtime_error("Cannot read the end of the file");
+        }
+        std::uint64_t offset = args.tail ? tail->offset : 0;
+        if (args.follow) {
+            // The follower picks up from the last complete line
+            follow_from = tail->end;
+            reader = open_range(offset, tail->end - std::min(offset, tail->end));
+        } else {
+            reader = open_range(offset, tail->size - std::min(offset, tail->size));
+        }
+        stats.describe(args.reverse ? "reverse mmap scan" : "mmap window", args.follow ? "--follow" : "--tail");
+    } else if (args.reverse) {
+        if (args.tail) {
+            throw std::runtime_error("--tail with --reverse needs a regular file");
+        }
+        reader = open_range(0, UINT64_MAX);
+        stats.describe("reverse mmap scan", seekable ? "--reverse" : "--reverse, spooled first");
+    } else {
+        ReaderOptions options{args.buffer_size, show_holes};
+        options.random_access = args.pager || args.lines || csv;
+        options.no_cache = args.no_cache;
+        options.plan = &stats.plan;
+        reader = create_file_reader(path, options);
+        stats.reader = strategy_name(stats.plan.strategy);
+    }
+    if (args.lines) {
+        reader = limit_lines(std::move(reader), args.lines->first, args.lines->last);
+    } else if (args.tail && !from_end) {
+        // No way to read these backwards
+        reader = last_lines(std::move(reader), *args.tail);
+    }
+    auto file_info = reader->info();
+    stats.info = file_info;
+    if (skip_binary && file_info.content.binary) {
+        return;
     }
 
+    // The content sniffed at open refines the name-based syntax: binary
+    // data is not highlighted, and on a terminal a file whose name says
+    // nothing gets the syntax its content suggests
+    if (!args.syntax) {
+        if (file_info.content.binary) {
+            syntax.reset();
+        } else if (!syntax && is_tty && !file_info.content.syntax.empty()) {
+            syntax = SyntaxDefinition{};
+            syntax->name = file_info.content.syntax;
+        }
+    }
+
+    // Determine if we should use pager
+    bool use_pager = !follow_from &&
+                     (args.pager || (is_tty && !args.tail && file_info.size_category == FileSize::Large));
+
     // Apply theme if requested
     std::optional<Theme> theme;
     if (args.theme) {
         theme = get_vim_theme();
     }
 
+    std::size_t last_line = 0;
     std::unique_ptr<Pager> pager;
     if (use_pager) {
         pager = std::make_unique<Pager>(
-            [](const std::string& text) { std::cout << text; },
+            out,
             0,  // auto-detect page size
             args.line_numbers  // line numbers
         );
@@ -108,17 +600,14 @@ void process_file(
             auto table = parse_csv(*reader);
             if (table) {
                 auto lines = format_rainbow_csv_table(*table);
-                for (const auto& line : lines) {
-                    if (use_pager && pager) {
-                        pager->output_line(line);
-                    } else {
-                        std::cout << line << "\n";
-                    }
+                if (use_pager && pager) {
+                    pager->output_lines(lines);
+                } else {
+                    out.write_lines(lines);
                 }
             } else {
-                while (auto result = reader->read_line()) {
-                    if (result->is_eof) break;
-                    std::cout << result->line << "\n";
+                while (auto view = reader->read_line_view()) {
+                    out << view->line << "\n";
                 }
             }
         } else if (args.align_csv || (syntax && syntax->name == "csv")) {
@@ -126,71 +615,57 @@ void process_file(
             auto table = parse_csv(*reader);
             if (table) {
                 auto lines = format_csv_table(*table);
-                for (const auto& line : lines) {
-                    if (use_pager && pager) {
-                        pager->output_line(line);
-                    } else {
-                        std::cout << line << "\n";
-                    }
+                if (use_pager && pager) {
+                    pager->output_lines(lines);
+                } else {
+                    out.write_lines(lines);
                 }
             } else {
                 // Fallback to regular output
-                while (auto result = reader->read_line()) {
-                    if (result->is_eof) break;
+                while (auto view = reader->read_line_view()) {
                     if (use_pager && pager) {
                         if (args.line_numbers) {
-                            pager->output_line_number(result->line, result->line_number);
+                            pager->output_line_number(view->line, view->line_number);
                         } else {
-                            pager->output_line(result->line);
+                            pager->output_line(view->line);
                         }
                     } else {
-                        std::cout << result->line << "\n";
+                        out << view->line << "\n";
                     }
                 }
             }
         } else if (args.align_md_table || (syntax && syntax->name == "markdown")) {
             // Markdown table alignment mode
-            std::vector<std::string> all_lines;
-            while (auto result = reader->read_line()) {
-                if (result->is_eof) break;
-                all_lines.push_back(result->line);
-            }
-
-            // Find and format markdown tables
-            std::size_t i = 0;
-            while (i < all_lines.size()) {
-                if (looks_like_md_table(all_lines[i]) && !is_md_table_separator(all_lines[i])) {
-                    // Collect consecutive table lines (skipping separators)
-                    std::vector<std::string> table_lines;
-                    while (i < all_lines.size() && looks_like_md_table(all_lines[i])) {
-                        if (!is_md_table_separator(all_lines[i])) {
-                            table_lines.push_back(all_lines[i]);
-                        }
-                        ++i;
-                    }
-
-                    // Format and output the table
-                    auto formatted = format_md_table(table_lines);
-                    for (const auto& line : formatted) {
-                        std::cout << line << "\n";
-                    }
-                } else {
-                    // Non-table line
-                    std::cout << all_lines[i] << "\n";
-                    ++i;
-                }
-            }
+            render_markdown(*reader, path == "-", out);
         } else {
-            // Regular file output with optional syntax highlighting
-            while (auto result = reader->read_line()) {
-                if (result->is_eof) break;
-                output_styled_line(result->line, result->line_number, syntax, theme, args.line_numbers, use_pager, pager.get());
+            // Regular file output with optional syntax highlighting, on all
+            // cores for large files when nothing reads it line by line
+            std::size_t threads = render_threads();
+            if (syntax && !use_pager && path != "-" && threads > 1 &&
+                file_info.size > kParallelFileLimit) {
+                last_line = render_chunked(*reader, syntax, theme, args.line_numbers, threads, out);
+            } else {
+                last_line = render_lines(*reader, syntax, theme, args.line_numbers, use_pager,
+                                         pager.get(), path == "-", out);
             }
         }
 
         if (pager) {
             pager->finalize();
         }
+
+        if (follow_from) {
+            // Appended lines are highlighted one by one as they arrive
+            out.flush();
+            FileFollower follower(path, *follow_from);
+            std::vector<std::string> lines;
+            while (follower.wait(lines)) {
+                for (const auto& line : lines) {
+                    output_styled_line(line, ++last_line, syntax, theme, args.line_numbers, false, nullptr, out);
+                }
+                out.flush();
+            }
+        }
     } catch (const std::runtime_error& e) {
         if (std::string(e.what()) != "pager_stopped") {
             throw;
@@ -199,8 +674,39 @@ void process_file(
     }
 }
 
+// Files may be rendered ahead on other threads only when nothing but
+// their output depends on when they are processed: no pager reading the
+// terminal, no --follow, no --stats timings
+bool can_render_parallel(const Arguments& args) {
+    return (args.files.size() > 1 || args.recursive) && !args.pager && !args.follow && !args.stats;
+}
+
+// OrderedRenderPool job: render `path` into `buffer`. Returns false for
+// what is better processed in turn on the main thread: stdin, FIFOs and
+// devices (read once, possibly blocking), files the kernel copy handles,
+// compressed files (output size unknown) and files over kParallelFileLimit.
+bool render_to_buffer(const std::string& path, const Arguments& args, bool is_tty, bool skip_binary,
+                      std::string& buffer) {
+    struct stat st;
+    if (path == "-" || stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+        static_cast<std::uint64_t>(st.st_size) > kParallelFileLimit) {
+        return false;
+    }
+    if (detect_compression(path) != Compression::None ||
+        is_plain_output(args, file_syntax(path, args, false))) {
+        return false;
+    }
+
+    // What was rendered before an error is still written
+    OutputSink out(buffer);
+    process_file(path, args, is_tty, out, skip_binary);
+    return true;
+}
+
 // Process stdin input
-void process_stdin(const Arguments& args) {
+void process_stdin(const Arguments& args, OutputSink& out) {
+    StatsReport stats(args.stats, "-");
+
     // Get syntax definition (use specified or default to cpp for stdin)
     std::optional<SyntaxDefinition> syntax;
     if (args.syntax) {
@@ -214,89 +720,120 @@ void process_stdin(const Arguments& args) {
         theme = get_vim_theme();
     }
 
-    // Collect all lines first for CSV processing
-    std::vector<std::string> lines;
-    std::string line;
-    while (std::getline(std::cin, line)) {
-        lines.push_back(line);
+    // Plain output needs no line structure at all
+    if (is_plain_output(args, syntax)) {
+        out.flush();
+        copy_file_raw("-", STDOUT_FILENO);
+        stats.describe("kernel copy", "plain output");
+        return;
     }
 
-    if (lines.empty()) return;
-
-    // Check if it looks like CSV
-    bool looks_like_csv_data = looks_like_csv(lines[0]);
-
-    if (args.rainbow_csv || (args.align_csv && looks_like_csv_data) || (syntax && syntax->name == "csv")) {
-        // Parse as CSV
-        struct StdinReader : public IFileReader {
-            std::vector<std::string> lines;
-            std::size_t idx = 0;
-            std::size_t line_num = 0;
-
-            StdinReader(std::vector<std::string>&& l) : lines(std::move(l)) {}
+    // Only CSV needs the whole input up front (column widths); spool it
+    // to a rewindable buffer. Everything else streams with bounded memory.
+    bool csv_mode = args.rainbow_csv || args.align_csv || (syntax && syntax->name == "csv");
+    std::unique_ptr<IFileReader> reader;
+    if (args.reverse) {
+        if (args.tail) {
+            std::cerr << "Error: --tail with --reverse needs a regular file, not stdin\n";
+            return;
+        }
+        // Rewindable either way, so CSV can use it directly
+        stats.describe("reverse mmap scan", "--reverse, spooled unless a regular file");
+        reader = create_reverse_reader("-", 0, UINT64_MAX, args.line_numbers);
+    } else if (csv_mode) {
+        stats.describe("spooled", "CSV needs every row");
+        reader = spool_input(STDIN_FILENO);
+    } else {
+        ReaderOptions options{args.buffer_size, args.show_holes};
+        options.plan = &stats.plan;
+        reader = create_file_reader("-", options);
+        stats.reader = strategy_name(stats.plan.strategy);
+    }
+    stats.info = reader->info();
+    if (args.lines) {
+        reader = limit_lines(std::move(reader), args.lines->first, args.lines->last);
+    } else if (args.tail) {
+        reader = last_lines(std::move(reader), *args.tail);
+    }
 
-            std::optional<ReadResult> read_line() override {
-                if (idx >= lines.size()) {
-                    return ReadResult{"", line_num, true};
-                }
-                return ReadResult{lines[idx++], ++line_num, false};
-            }
+    if (csv_mode) {
+        // Check if it looks like CSV
+        auto first = reader->read_line_view();
+        if (!first) return;
+        bool looks_like_csv_data = looks_like_csv(first->line);
+        reader->rewind();
 
-            bool seek(std::size_t) override { return false; }
-            FileInfo info() const override { return {"/dev/stdin", 0, FileSize::Small}; }
-            bool is_large() const override { return false; }
-            void rewind() override { idx = 0; }
-        };
-
-        StdinReader reader(std::move(lines));
-        auto table = parse_csv(reader);
-        if (table) {
-            auto formatted = args.rainbow_csv ? format_rainbow_csv_table(*table) : format_csv_table(*table);
-            for (const auto& l : formatted) {
-                std::cout << l << "\n";
+        if (args.rainbow_csv || (args.align_csv && looks_like_csv_data) || (syntax && syntax->name == "csv")) {
+            auto table = parse_csv(*reader);
+            if (table) {
+                auto formatted = args.rainbow_csv ? format_rainbow_csv_table(*table) : format_csv_table(*table);
+                out.write_lines(formatted);
+                return;
             }
-            return;
+            reader->rewind();
         }
     }
 
     // Check for markdown table
     bool looks_like_md = args.align_md_table || (syntax && syntax->name == "markdown");
     if (looks_like_md) {
-        // Find and format markdown tables
-        std::size_t i = 0;
-        while (i < lines.size()) {
-            if (looks_like_md_table(lines[i]) && !is_md_table_separator(lines[i])) {
-                // Collect consecutive table lines (skipping separators)
-                std::vector<std::string> table_lines;
-                while (i < lines.size() && looks_like_md_table(lines[i])) {
-                    if (!is_md_table_separator(lines[i])) {
-                        table_lines.push_back(lines[i]);
-                    }
-                    ++i;
-                }
-
-                // Format and output the table
-                auto formatted = format_md_table(table_lines);
-                for (const auto& line : formatted) {
-                    std::cout << line << "\n";
-                }
-            } else {
-                // Non-table line
-                std::cout << lines[i] << "\n";
-                ++i;
-            }
-        }
+        render_markdown(*reader, true, out);
         return;
     }
 
     // Regular line-by-line output
-    std::size_t line_num = 0;
-    for (const auto& l : lines) {
-        ++line_num;
-        output_styled_line(l, line_num, syntax, theme, args.line_numbers, false, nullptr);
-    }
+    render_lines(*reader, syntax, theme, args.line_numbers, false, nullptr, true, out);
 }
 
+// A file to print: from the command line, or found under a directory by
+// -r, which leaves out binary files
+struct Input {
+    std::string path;
+    bool walked = false;
+    std::string error = {};  // Reported in its place instead (unreadable -r root)
+};
+
+// The files to print, in order. With -r, walks append to it from their
+// threads while the first files are printed and rendered.
+class InputList {
+public:
+    void add(Input input) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inputs_.push_back(std::move(input));
+        }
+        cv_.notify_all();
+    }
+
+    // No more inputs after those added
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    // Input `index`, once it is added; std::nullopt if the list closes first
+    std::optional<Input> get(std::size_t index) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return index < inputs_.size() || closed_; });
+        if (index >= inputs_.size()) return std::nullopt;
+        return inputs_[index];
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return inputs_.size();
+    }
+
+private:
+    std::deque<Input> inputs_;
+    bool closed_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
 }  // namespace fastcat
 
 int main(int argc, char* argv[]) {
@@ -313,19 +850,129 @@ int main(int argc, char* argv[]) {
 
     // If -e flag is set, read from stdin
     if (args->echo) {
-        fastcat::process_stdin(*args);
+        if (args->bytes) {
+            std::cerr << "Error: --bytes needs a regular file, not stdin\n";
+            return 1;
+        }
+        try {
+            OutputSink out(STDOUT_FILENO);
+            fastcat::process_stdin(*args, out);
+            out.flush();
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
         return 0;
     }
 
+    // -r: each directory stands for the text files under it, walked on
+    // other threads while the first of them are printed
+    bool walks = false;
+    if (args->recursive) {
+        for (const auto& path : args->files) {
+            struct stat st;
+            walks |= path != "-" && stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+    }
+
+    OutputSink out(STDOUT_FILENO);
+    InputList inputs;
+
+    // Warm the next files while each one is printed (not with --no-cache,
+    // which is there to keep the page cache as it is)
+    std::optional<FilePrefetcher> prefetch;
+    if ((args->files.size() > 1 || walks) && !args->no_cache) {
+        prefetch.emplace(std::vector<std::string>{});
+    }
+
+    // Render files on all cores, each into its own buffer; the buffers are
+    // written here in input order, so the output is the same
+    std::optional<OrderedRenderPool> pool;
+    std::size_t threads = render_threads();
+    if (threads > 1 && can_render_parallel(*args)) {
+        pool.emplace(0, threads,
+                     [&](std::size_t i, std::string& buffer) {
+                         auto input = inputs.get(i);
+                         return input && input->error.empty() &&
+                                render_to_buffer(input->path, *args, is_tty, input->walked, buffer);
+                     },
+                     threads * kRenderAheadPerThread);
+    }
+
+    std::atomic<bool> cancelled{false};  // Nothing more is printed
+    auto add = [&](Input input) {
+        if (prefetch) prefetch->add(input.path);
+        inputs.add(std::move(input));
+        if (pool) pool->extend(inputs.size());
+    };
+    auto feed = [&] {
+        for (const auto& path : args->files) {
+            struct stat st;
+            if (!walks || path == "-" || stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+                add(Input{path});
+                continue;
+            }
+            try {
+                walk_tree(path, WalkOptions{std::max(render_threads(), kMinWalkThreads)},
+                          [&](const std::string& file) {
+                              add(Input{file, true});
+                              return !cancelled;
+                          });
+            } catch (const std::exception& e) {
+                add(Input{path, false, e.what()});
+            }
+            if (cancelled) break;
+        }
+        inputs.close();
+    };
+    std::thread feeder;
+    if (walks) {
+        feeder = std::thread(feed);
+    } else {
+        feed();
+    }
+
     // Process each file
-    for (const auto& path : args->files) {
-        try {
-            process_file(path, *args, is_tty);
-        } catch (const std::exception& e) {
-            std::cerr << "Error processing " << path << ": " << e.what() << "\n";
-            return 1;
+    auto print = [&] {
+        for (std::size_t i = 0;; ++i) {
+            auto input = inputs.get(i);
+            if (!input) return 0;
+            const std::string& path = input->path;
+            if (prefetch) prefetch->advance(i);
+            try {
+                if (!input->error.empty()) {
+                    throw std::runtime_error(input->error);
+                }
+                if (pool) {
+                    auto result = pool->take(i);
+                    out.write(result.output);
+                    if (result.error) std::rethrow_exception(result.error);
+                    if (result.rendered) continue;
+                }
+                process_file(path, *args, is_tty, out, input->walked);
+            } catch (const std::exception& e) {
+                // What came before the error is shown before it
+                try {
+                    out.flush();
+                } catch (const std::exception&) {
+                }
+                std::cerr << "Error processing " << path << ": " << e.what() << "\n";
+                return 1;
+            }
         }
+    };
+    int status = print();
+    cancelled = true;
+    if (feeder.joinable()) feeder.join();
+    if (status != 0) {
+        return status;
     }
 
+    try {
+        out.flush();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
     return 0;
 }
@@ -0,0 +1,159 @@
+#include "ordered_render.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace fastcat {
+
+std::size_t render_threads() {
+    // FASTCAT_THREADS, for benchmarks and for single-core comparisons
+    if (const char* forced = std::getenv("FASTCAT_THREADS"); forced && *forced) {
+        long n = std::strtol(forced, nullptr, 10);
+        if (n > 0) return std::min<std::size_t>(static_cast<std::size_t>(n), kMaxRenderThreads);
+    }
+    return std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, kMaxRenderThreads);
+}
+
+OrderedRenderPool::OrderedRenderPool(std::size_t count, std::size_t threads, RenderFn render,
+                                     std::size_t ahead, std::uint64_t budget)
+    : threads_(std::max<std::size_t>(threads, 1)), render_(std::move(render)),
+      ahead_(std::max<std::size_t>(ahead, 1)), budget_(budget) {
+    workers_.reserve(threads_);
+    extend(count);
+}
+
+OrderedRenderPool::~OrderedRenderPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    // Jobs already started run to completion
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void OrderedRenderPool::extend(std::size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count <= count_) return;
+        count_ = count;
+        results_.resize(count);
+        // No more threads than jobs
+        while (workers_.size() < std::min(threads_, count_)) {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+    work_cv_.notify_all();
+}
+
+OrderedRenderPool::Result OrderedRenderPool::take(std::size_t index) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&] { return index < results_.size() && results_[index].has_value(); });
+    Result result = std::move(*results_[index]);
+    results_[index].reset();
+    buffered_ -= result.output.size();
+    taken_ = index + 1;
+    lock.unlock();
+    work_cv_.notify_all();
+    return result;
+}
+
+void OrderedRenderPool::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Over budget there is always a finished job for take() to free,
+        // since jobs start in order
+        work_cv_.wait(lock, [&] {
+            return stop_ || (next_ < count_ && next_ < taken_ + ahead_ && buffered_ < budget_);
+        });
+        if (stop_) return;
+
+        std::size_t index = next_++;
+        lock.unlock();
+
+        Result result;
+        try {
+            result.rendered = render_(index, result.output);
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+
+        lock.lock();
+        buffered_ += result.output.size();
+        results_[index] = std::move(result);
+        done_cv_.notify_all();
+    }
+}
+
+OrderedTaskQueue::OrderedTaskQueue(std::size_t threads) {
+    threads = std::max<std::size_t>(threads, 1);
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { run(); });
+    }
+}
+
+OrderedTaskQueue::~OrderedTaskQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    // Tasks already started run to completion; the rest are dropped
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void OrderedTaskQueue::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_.emplace_back().task = std::move(task);
+    }
+    work_cv_.notify_one();
+}
+
+std::size_t OrderedTaskQueue::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_.size();
+}
+
+std::string OrderedTaskQueue::take() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&] { return !slots_.empty() && slots_.front().done; });
+    Slot slot = std::move(slots_.front());
+    slots_.pop_front();
+    --started_;
+    lock.unlock();
+
+    if (slot.error) std::rethrow_exception(slot.error);
+    return std::move(slot.output);
+}
+
+void OrderedTaskQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [&] { return stop_ || started_ < slots_.size(); });
+        if (stop_) return;
+
+        // Stays put: deque references survive push_back and pop_front of
+        // other elements, and this slot is not popped before it is done
+        Slot& slot = slots_[started_++];
+        lock.unlock();
+
+        try {
+            slot.task(slot.output);
+        } catch (...) {
+            slot.error = std::current_exception();
+        }
+        slot.task = nullptr;
+
+        lock.lock();
+        slot.done = true;
+        done_cv_.notify_all();
+    }
+}
+
+}  // namespace fastcat
@@ -0,0 +1,143 @@
+#include "output_sink.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+// Most iovecs one writev(2) accepts
+constexpr std::size_t kMaxIovecs = IOV_MAX;
+
+std::size_t sink_capacity(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return kDefaultSinkBuffer;
+    if (S_ISREG(st.st_mode) || S_ISBLK(st.st_mode)) return kFileSinkBuffer;
+    if (S_ISFIFO(st.st_mode)) {
+        int pipe_size = fcntl(fd, F_GETPIPE_SZ);
+        return pipe_size > 0 ? static_cast<std::size_t>(pipe_size) : kDefaultSinkBuffer;
+    }
+    if (isatty(fd)) return kTerminalSinkBuffer;
+    return kDefaultSinkBuffer;
+}
+
+}  // namespace
+
+OutputSink::OutputSink(int fd) : fd_(fd), capacity_(sink_capacity(fd)) {
+    buffer_ = std::make_unique<char[]>(capacity_);
+}
+
+OutputSink::OutputSink(std::string& target) : target_(&target) {
+    buffer_ = std::make_unique<char[]>(capacity_);
+}
+
+OutputSink::~OutputSink() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Nowhere left to report it
+    }
+}
+
+void OutputSink::write_slow(const char* data, std::size_t len) {
+    if (len < capacity_) {
+        // Top the buffer up so every write(2) is a full one
+        std::size_t fits = capacity_ - used_;
+        std::memcpy(buffer_.get() + used_, data, fits);
+        used_ = capacity_;
+        drain(nullptr, 0);
+        std::memcpy(buffer_.get(), data + fits, len - fits);
+        used_ = len - fits;
+        return;
+    }
+    // Too large to be worth copying: out with the buffer in one call
+    drain(data, len);
+}
+
+void OutputSink::write(std::span<const struct iovec> pieces) {
+    std::size_t total = 0;
+    for (const auto& piece : pieces) total += piece.iov_len;
+    // Small batches are cheaper copied than gathered
+    if (target_ || total < capacity_) {
+        for (const auto& piece : pieces) {
+            write(static_cast<const char*>(piece.iov_base), piece.iov_len);
+        }
+        return;
+    }
+
+    std::vector<struct iovec> iov;
+    iov.reserve(std::min(pieces.size() + 1, kMaxIovecs));
+    if (used_) iov.push_back({buffer_.get(), used_});
+    for (const auto& piece : pieces) {
+        if (piece.iov_len == 0) continue;
+        iov.push_back(piece);
+        if (iov.size() == kMaxIovecs) {
+            write_all(iov.data(), iov.size());
+            iov.clear();
+        }
+    }
+    if (!iov.empty()) write_all(iov.data(), iov.size());
+    used_ = 0;
+}
+
+void OutputSink::write_lines(std::span<const std::string_view> lines) {
+    for (auto line : lines) {
+        write(line);
+        put('\n');
+    }
+}
+
+void OutputSink::write_lines(std::span<const std::string> lines) {
+    for (const auto& line : lines) {
+        write(line);
+        put('\n');
+    }
+}
+
+void OutputSink::drain(const char* data, std::size_t len) {
+    if (target_) {
+        target_->append(buffer_.get(), used_);
+        target_->append(data ? data : "", len);
+    } else {
+        struct iovec iov[2] = {{buffer_.get(), used_}, {const_cast<char*>(data), len}};
+        write_all(iov, len ? 2 : 1);
+    }
+    used_ = 0;
+}
+
+void OutputSink::write_all(struct iovec* iov, std::size_t count) {
+    while (count > 0) {
+        ssize_t n = writev(fd_, iov, static_cast<int>(std::min(count, kMaxIovecs)));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // stdout inherited in non-blocking mode
+                struct pollfd pfd = {fd_, POLLOUT, 0};
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            throw std::runtime_error("Cannot write output: " + std::string(std::strerror(errno)));
+        }
+        // Step past what was written
+        auto done = static_cast<std::size_t>(n);
+        while (count > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+            iov->iov_len -= done;
+        }
+    }
+}
+
+}  // namespace fastcat
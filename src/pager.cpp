@@ -1,5 +1,7 @@
 #include "pager.h"
-#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <termios.h>
@@ -32,11 +34,11 @@ bool should_use_pager(PagerMode mode, std::uintmax_t file_size, bool is_tty) {
 }
 
 Pager::Pager(
-    OutputCallback output,
+    OutputSink& sink,
     std::size_t page_lines,
     bool line_numbers
 )
-    : output_(std::move(output))
+    : sink_(sink)
     , page_lines_(page_lines)
     , line_numbers_(line_numbers)
     , lines_output_(0)
@@ -48,33 +50,54 @@ Pager::Pager(
     }
 }
 
-void Pager::output(const std::string& text) {
-    output_(text);
+void Pager::output(std::string_view text) {
+    sink_.write(text);
 }
 
-void Pager::output_line(const std::string& line) {
-    output_(line);
-    output_("\n");
+void Pager::output_line(std::string_view line) {
+    sink_.write(line);
+    sink_.put('\n');
     ++lines_output_;
     ++lines_since_pause_;
     maybe_pause();
 }
 
-void Pager::output_line_number(const std::string& line, std::size_t line_num) {
+void Pager::output_line_number(std::string_view line, std::size_t line_num) {
     if (line_numbers_) {
         char buf[32];
-        snprintf(buf, sizeof(buf), "%6zu  ", line_num);
-        output_(buf);
+        int len = snprintf(buf, sizeof(buf), "%6zu  ", line_num);
+        sink_.write(buf, static_cast<std::size_t>(len));
     }
-    output_(line);
-    output_("\n");
+    sink_.write(line);
+    sink_.put('\n');
     ++lines_output_;
     ++lines_since_pause_;
     maybe_pause();
 }
 
+template <typename Line>
+void Pager::output_batch(std::span<const Line> lines) {
+    while (!lines.empty()) {
+        std::size_t room = page_lines_ > lines_since_pause_ ? page_lines_ - lines_since_pause_ : 1;
+        std::size_t n = std::min(room, lines.size());
+        sink_.write_lines(lines.first(n));
+        lines = lines.subspan(n);
+        lines_output_ += n;
+        lines_since_pause_ += n;
+        maybe_pause();
+    }
+}
+
+void Pager::output_lines(std::span<const std::string_view> lines) {
+    output_batch(lines);
+}
+
+void Pager::output_lines(std::span<const std::string> lines) {
+    output_batch(lines);
+}
+
 void Pager::flush() {
-    std::cout.flush();
+    sink_.flush();
 }
 
 void Pager::finalize() {
@@ -90,8 +113,8 @@ void Pager::maybe_pause() {
 }
 
 void Pager::wait_for_input() {
-    output_("\033[7m-- More --\033[0m");
-    std::cout.flush();
+    sink_.write("\033[7m-- More --\033[0m");
+    sink_.flush();
 
     // Read single character without echo
     struct termios old_settings, new_settings;
@@ -106,8 +129,8 @@ void Pager::wait_for_input() {
     tcsetattr(STDIN_FILENO, TCSANOW, &old_settings);
 
     // Clear the "More" message
-    output_("\033[1G\033[K");
-    std::cout.flush();
+    sink_.write("\033[1G\033[K");
+    sink_.flush();
 
     if (n <= 0 || c == 'q' || c == 'Q' || c == 27) {
         throw std::runtime_error("pager_stopped");
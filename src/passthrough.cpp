@@ -0,0 +1,169 @@
+#include "passthrough.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+// Buffer for the read/write fallback loop
+constexpr std::size_t kCopyBufferSize = 256 * 1024;
+
+// Upper bound per kernel copy call, keeps each syscall interruptible
+constexpr std::size_t kKernelChunk = 1u << 30;
+
+[[noreturn]] void throw_errno(const char* what) {
+    throw std::runtime_error(std::string(what) + " failed: " + std::strerror(errno));
+}
+
+// Block until fd, inherited in non-blocking mode, takes more output
+void wait_writable(int fd) {
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    poll(&pfd, 1, -1);
+}
+
+void write_all(int fd, const char* data, std::size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                wait_writable(fd);
+                continue;
+            }
+            throw_errno("write");
+        }
+        data += n;
+        len -= static_cast<std::size_t>(n);
+    }
+}
+
+enum class KernelCopy {
+    CopyFileRange,  // regular file -> regular file, may share extents
+    Splice,         // regular file -> pipe, moves page references
+    Sendfile,       // regular file -> anything else (tty, socket, ...)
+};
+
+// Copy in_fd[offset, size) to out_fd inside the kernel, advancing offset.
+// Stops early, leaving the rest to the caller, if no kernel method accepts
+// this pair of descriptors.
+void copy_kernel(int in_fd, int out_fd, mode_t out_mode, off_t& offset, off_t size) {
+    KernelCopy method = S_ISREG(out_mode)  ? KernelCopy::CopyFileRange
+                      : S_ISFIFO(out_mode) ? KernelCopy::Splice
+                                           : KernelCopy::Sendfile;
+
+    while (offset < size) {
+        std::size_t want = std::min<std::size_t>(size - offset, kKernelChunk);
+        ssize_t n = 0;
+        switch (method) {
+            case KernelCopy::CopyFileRange:
+                n = copy_file_range(in_fd, &offset, out_fd, nullptr, want, 0);
+                break;
+            case KernelCopy::Splice:
+                n = splice(in_fd, &offset, out_fd, nullptr, want, SPLICE_F_MORE);
+                break;
+            case KernelCopy::Sendfile:
+                n = sendfile(out_fd, in_fd, &offset, want);
+                break;
+        }
+
+        if (n > 0) continue;  // The kernel advanced offset for us
+        if (n == 0) return;   // File shrank underneath us
+
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // The input is a regular file, so it is the output that is full
+            wait_writable(out_fd);
+            continue;
+        }
+
+        // Unsupported for these descriptors (cross-device, O_APPEND output,
+        // old kernel, ...): degrade to the next more general method
+        bool unsupported = errno == EINVAL || errno == ENOSYS || errno == EXDEV ||
+                           errno == EOPNOTSUPP || errno == EBADF;
+        if (unsupported && method != KernelCopy::Sendfile) {
+            method = KernelCopy::Sendfile;
+            continue;
+        }
+        if (unsupported && errno != EBADF) {
+            return;
+        }
+        throw_errno("copy");
+    }
+}
+
+// Copy whatever remains on in_fd to out_fd through a userspace buffer
+void copy_buffered(int in_fd, int out_fd, char& last, bool& copied_any) {
+    auto buffer = std::make_unique<char[]>(kCopyBufferSize);
+    while (true) {
+        ssize_t n = ::read(in_fd, buffer.get(), kCopyBufferSize);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw_errno("read");
+        }
+        if (n == 0) break;
+        write_all(out_fd, buffer.get(), static_cast<std::size_t>(n));
+        last = buffer[n - 1];
+        copied_any = true;
+    }
+}
+
+}  // namespace
+
+bool copy_file_raw(const std::string& path, int out_fd) {
+    bool is_stdin = (path == "-");
+    int in_fd = is_stdin ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in_fd < 0) {
+        return false;
+    }
+
+    struct FdCloser {
+        int fd;
+        bool owned;
+        ~FdCloser() { if (owned) ::close(fd); }
+    } closer{in_fd, !is_stdin};
+
+    struct stat in_st, out_st;
+    if (fstat(in_fd, &in_st) != 0 || S_ISDIR(in_st.st_mode) ||
+        fstat(out_fd, &out_st) != 0) {
+        return false;
+    }
+
+    char last = '\n';
+    bool copied_any = false;
+
+    if (S_ISREG(in_st.st_mode) && in_st.st_size > 0) {
+        off_t start = lseek(in_fd, 0, SEEK_CUR);
+        off_t offset = start < 0 ? 0 : start;
+        posix_fadvise(in_fd, offset, 0, POSIX_FADV_SEQUENTIAL);
+
+        copy_kernel(in_fd, out_fd, out_st.st_mode, offset, in_st.st_size);
+
+        if (offset > start) {
+            copied_any = true;
+            if (pread(in_fd, &last, 1, offset - 1) != 1) {
+                last = '\n';
+            }
+        }
+        lseek(in_fd, offset, SEEK_SET);
+    }
+
+    // Pipes, /proc files (size 0), growing files and the kernel-copy leftovers
+    copy_buffered(in_fd, out_fd, last, copied_any);
+
+    // Match the line-based path, which terminates every line
+    if (copied_any && last != '\n') {
+        write_all(out_fd, "\n", 1);
+    }
+    return true;
+}
+
+}  // namespace fastcat
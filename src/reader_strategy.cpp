@@ -0,0 +1,198 @@
+#include "reader_strategy.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <vector>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <linux/magic.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+namespace fastcat {
+
+namespace {
+
+// Size thresholds, as for FileSize
+constexpr std::uint64_t kSmallFile = 1024 * 1024;
+constexpr std::uint64_t kLargeFile = 100 * 1024 * 1024;
+
+// Page-cache residency is sampled in this many windows of kSampleSpan
+// bytes spread over the file; files up to their total are checked whole
+constexpr std::uint64_t kSampleWindows = 16;
+constexpr std::uint64_t kSampleSpan = 1024 * 1024;
+
+// A file this cached is read as fast from the mapping as it can be copied
+constexpr int kResidentPercent = 90;
+
+// Share of the file's pages in the page cache, by mincore over a mapping
+// that is never touched; -1 if the file cannot be mapped
+int sample_residency(int fd, std::uint64_t size) {
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) return -1;
+
+    const std::uint64_t page = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+    const std::uint64_t span = std::min(size, kSampleSpan);
+    const std::uint64_t windows = size <= kSampleWindows * kSampleSpan
+                                      ? (size + span - 1) / span
+                                      : kSampleWindows;
+    std::vector<unsigned char> vec((span + page - 1) / page);
+    std::uint64_t resident = 0, total = 0;
+    for (std::uint64_t k = 0; k < windows; ++k) {
+        std::uint64_t offset = windows == 1 ? 0 : (size - span) * k / (windows - 1);
+        offset = offset / page * page;
+        std::uint64_t len = std::min(span, size - offset);
+        if (mincore(static_cast<char*>(addr) + offset, len, vec.data()) != 0) continue;
+        std::uint64_t pages = (len + page - 1) / page;
+        for (std::uint64_t p = 0; p < pages; ++p) resident += vec[p] & 1;
+        total += pages;
+    }
+    munmap(addr, size);
+    return total ? static_cast<int>(resident * 100 / total) : -1;
+}
+
+// FASTCAT_READER, for benchmarks and for working around a bad choice
+std::optional<ReaderStrategy> forced_strategy() {
+    const char* name = std::getenv("FASTCAT_READER");
+    if (!name) return std::nullopt;
+    if (std::strcmp(name, "mmap") == 0) return ReaderStrategy::Mmap;
+    if (std::strcmp(name, "window") == 0) return ReaderStrategy::WindowedMmap;
+    if (std::strcmp(name, "buffered") == 0) return ReaderStrategy::Buffered;
+    if (std::strcmp(name, "async") == 0) return ReaderStrategy::Async;
+    return std::nullopt;
+}
+
+}  // namespace
+
+bool is_virtual_fs(int fd) {
+    struct statfs fs;
+    if (fstatfs(fd, &fs) != 0) return false;
+    return fs.f_type == PROC_SUPER_MAGIC || fs.f_type == SYSFS_MAGIC;
+}
+
+std::uint64_t available_memory() {
+    if (FILE* meminfo = std::fopen("/proc/meminfo", "re")) {
+        char line[128];
+        unsigned long long kb = 0;
+        bool found = false;
+        while (!found && std::fgets(line, sizeof(line), meminfo)) {
+            found = std::sscanf(line, "MemAvailable: %llu kB", &kb) == 1;
+        }
+        std::fclose(meminfo);
+        if (found) return static_cast<std::uint64_t>(kb) * 1024;
+    }
+    // Older kernels: free pages only, which leaves out reclaimable cache
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long page = sysconf(_SC_PAGESIZE);
+    return pages > 0 && page > 0 ? static_cast<std::uint64_t>(pages) * static_cast<std::uint64_t>(page) : 0;
+}
+
+ReaderPlan plan_reader(int fd, bool random_access) {
+    ReaderPlan plan;
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        plan.reason = "cannot stat";
+        return plan;
+    }
+
+    if (S_ISFIFO(st.st_mode)) {
+        plan.kind = FileKind::Pipe;
+        plan.reason = "pipe, sequential reads only";
+        return plan;
+    }
+    if (S_ISSOCK(st.st_mode)) {
+        plan.kind = FileKind::Socket;
+        plan.reason = "socket, sequential reads only";
+        return plan;
+    }
+    if (S_ISCHR(st.st_mode)) {
+        plan.kind = FileKind::CharDevice;
+        plan.reason = "character device, sequential reads only";
+        return plan;
+    }
+    if (S_ISBLK(st.st_mode)) {
+        // st_size is 0 for devices; the mapping would be empty
+        plan.kind = FileKind::BlockDevice;
+        std::uint64_t bytes = 0;
+        if (ioctl(fd, BLKGETSIZE64, &bytes) == 0) plan.size = bytes;
+        plan.strategy = plan.size >= kLargeFile ? ReaderStrategy::Async : ReaderStrategy::Buffered;
+        plan.reason = "block device, sized by ioctl";
+        return plan;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        plan.reason = "not a regular file";
+        return plan;
+    }
+
+    plan.kind = FileKind::Regular;
+    plan.size = static_cast<std::uint64_t>(st.st_size);
+    if (is_virtual_fs(fd)) {
+        // /proc and /sys report 0 or one page whatever they hold
+        plan.kind = FileKind::Virtual;
+        plan.reason = "procfs/sysfs, size unknown until read";
+        return plan;
+    }
+    if (auto forced = forced_strategy()) {
+        plan.strategy = *forced;
+        plan.reason = "FASTCAT_READER";
+        return plan;
+    }
+    if (plan.size == 0) {
+        plan.reason = "empty, or size not reported";
+        return plan;
+    }
+    if (plan.size < kSmallFile) {
+        plan.strategy = ReaderStrategy::Mmap;
+        plan.reason = "small file";
+        return plan;
+    }
+
+    plan.available_memory = available_memory();
+    plan.resident_percent = sample_residency(fd, plan.size);
+    bool fits = plan.available_memory == 0 || plan.size <= plan.available_memory / 2;
+
+    if (fits && plan.resident_percent >= kResidentPercent) {
+        plan.strategy = ReaderStrategy::Mmap;
+        plan.reason = "in page cache, no disk reads to overlap";
+    } else if (random_access) {
+        plan.strategy = fits ? ReaderStrategy::Mmap : ReaderStrategy::WindowedMmap;
+        plan.reason = fits ? "random access, fits in memory" : "random access, larger than half of available memory";
+    } else if (plan.size >= kLargeFile) {
+        plan.strategy = ReaderStrategy::Async;
+        plan.reason = fits ? "large file, not cached" : "larger than half of available memory";
+    } else {
+        plan.reason = fits ? "not cached" : "larger than half of available memory";
+    }
+    return plan;
+}
+
+const char* strategy_name(ReaderStrategy strategy) {
+    switch (strategy) {
+        case ReaderStrategy::Mmap: return "mmap";
+        case ReaderStrategy::WindowedMmap: return "sliding mmap window";
+        case ReaderStrategy::Buffered: return "buffered read";
+        case ReaderStrategy::Async: return "async read-ahead";
+        case ReaderStrategy::Decompress: return "decompress";
+    }
+    return "unknown";
+}
+
+const char* file_kind_name(FileKind kind) {
+    switch (kind) {
+        case FileKind::Regular: return "regular file";
+        case FileKind::Virtual: return "virtual file";
+        case FileKind::Pipe: return "pipe";
+        case FileKind::Socket: return "socket";
+        case FileKind::CharDevice: return "character device";
+        case FileKind::BlockDevice: return "block device";
+        case FileKind::Other: return "other";
+    }
+    return "unknown";
+}
+
+}  // namespace fastcat
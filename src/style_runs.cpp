@@ -0,0 +1,393 @@
+#include "style_runs.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+namespace fastcat {
+
+namespace {
+
+constexpr std::uint8_t kBold = 1;
+constexpr std::uint8_t kDim = 2;
+constexpr std::uint8_t kItalic = 4;
+constexpr std::uint8_t kUnderline = 8;
+
+// SGR parameter that turns each flag on, in flag order
+constexpr const char* kFlagCodes[] = {"1", "2", "3", "4"};
+
+struct Style {
+    std::uint8_t flags = 0;
+    std::string_view fg;  // Foreground parameters ("33", "38;5;208") in the token text; empty for the default
+    std::string extra;  // Parameters not modelled (background, inverse, ...), verbatim
+
+    bool operator==(const Style&) const = default;
+    bool is_default() const { return flags == 0 && fg.empty() && extra.empty(); }
+};
+
+int sgr_code(std::string_view param) {
+    if (param.empty()) return 0;
+    int code = 0;
+    for (char c : param) {
+        if (c < '0' || c > '9' || code > 1000) return -1;
+        code = code * 10 + (c - '0');
+    }
+    return code;
+}
+
+// Apply the parameters of one SGR sequence ("1;34") to style; style.fg
+// may point into params
+void apply_sgr(std::string_view params, Style& style) {
+    // Parameters split on ';', an empty one meaning 0 (reset)
+    std::size_t pos = 0;
+    auto next = [&](std::string_view& param) {
+        if (pos > params.size()) return false;
+        std::size_t semi = std::min(params.find(';', pos), params.size());
+        param = params.substr(pos, semi - pos);
+        pos = semi + 1;
+        return true;
+    };
+
+    std::string_view param;
+    while (next(param)) {
+        int code = sgr_code(param);
+        if (code == 0) {
+            style = Style{};
+        } else if (code >= 1 && code <= 4) {
+            style.flags |= static_cast<std::uint8_t>(1u << (code - 1));
+        } else if (code == 22) {
+            style.flags &= static_cast<std::uint8_t>(~(kBold | kDim));
+        } else if (code == 23) {
+            style.flags &= static_cast<std::uint8_t>(~kItalic);
+        } else if (code == 24) {
+            style.flags &= static_cast<std::uint8_t>(~kUnderline);
+        } else if ((code >= 30 && code <= 37) || (code >= 90 && code <= 97)) {
+            style.fg = param;
+        } else if (code == 39) {
+            style.fg = {};
+        } else {
+            // 38;5;N or 38;2;R;G;B, kept as one run of the text
+            std::size_t start = static_cast<std::size_t>(param.data() - params.data());
+            std::size_t resume = pos;
+            std::string_view kind, value;
+            bool colour = code == 38 && next(kind) &&
+                          ((sgr_code(kind) == 5 && next(value)) ||
+                           (sgr_code(kind) == 2 && next(value) && next(value) && next(value)));
+            if (colour) {
+                style.fg = params.substr(start, static_cast<std::size_t>(value.data() - params.data()) + value.size() - start);
+            } else {
+                pos = resume;
+                if (!style.extra.empty()) style.extra += ';';
+                style.extra.append(param);
+            }
+        }
+    }
+}
+
+// Length of the SGR sequence (CSI, digits and ';', then 'm') text starts
+// with; 0 if it starts with anything else
+std::size_t sgr_length(std::string_view text) {
+    if (text.size() < 3 || text[0] != '\033' || text[1] != '[') return 0;
+    std::size_t end = 2;
+    while (end < text.size() && (std::isdigit(static_cast<unsigned char>(text[end])) || text[end] == ';')) {
+        ++end;
+    }
+    return end < text.size() && text[end] == 'm' ? end + 1 : 0;
+}
+
+// Length of "reset, then set everything `to` has"
+std::size_t reset_length(const Style& to) {
+    if (to.is_default()) return 4;  // \033[0m
+    std::size_t len = 4;
+    for (std::size_t bit = 0; bit < std::size(kFlagCodes); ++bit) {
+        if (to.flags & (1u << bit)) len += 2;
+    }
+    if (!to.fg.empty()) len += 1 + to.fg.size();
+    if (!to.extra.empty()) len += 1 + to.extra.size();
+    return len;
+}
+
+void append_reset_to(const Style& to, std::string& out) {
+    out += "\033[0";
+    for (std::size_t bit = 0; bit < std::size(kFlagCodes); ++bit) {
+        if (to.flags & (1u << bit)) {
+            out += ';';
+            out += kFlagCodes[bit];
+        }
+    }
+    if (!to.fg.empty()) {
+        out += ';';
+        out += to.fg;
+    }
+    if (!to.extra.empty()) {
+        out += ';';
+        out += to.extra;
+    }
+    out += 'm';
+}
+
+// Longest foreground an incremental change is built for; longer ones
+// (38;2;R;G;B is at most 16) are reset to
+constexpr std::size_t kMaxChangeFg = 24;
+
+// One SGR sequence taking the terminal from `from` to `to`: only the
+// attributes that change, unless a reset is shorter (or the only way,
+// with unmodelled attributes to drop)
+void append_transition(const Style& from, const Style& to, std::string& out) {
+    if (from.extra != to.extra || to.fg.size() > kMaxChangeFg) {
+        append_reset_to(to, out);
+        return;
+    }
+
+    // The parameters, each after a ';'
+    char change[4 * 3 + 1 + kMaxChangeFg];
+    std::size_t len = 0;
+    auto param = [&](std::string_view p) {
+        change[len++] = ';';
+        std::memcpy(change + len, p.data(), p.size());
+        len += p.size();
+    };
+
+    std::uint8_t flags = from.flags;
+    if (flags & ~to.flags & (kBold | kDim)) {
+        // 22 clears both
+        param("22");
+        flags &= static_cast<std::uint8_t>(~(kBold | kDim));
+    }
+    if (flags & ~to.flags & kItalic) param("23");
+    if (flags & ~to.flags & kUnderline) param("24");
+    for (std::size_t bit = 0; bit < std::size(kFlagCodes); ++bit) {
+        if ((to.flags & (1u << bit)) && !(flags & (1u << bit))) param(kFlagCodes[bit]);
+    }
+    if (from.fg != to.fg) param(to.fg.empty() ? "39" : to.fg);
+
+    // \033[ and m around the parameters, less the first ';'
+    if (len + 2 > reset_length(to)) {
+        append_reset_to(to, out);
+        return;
+    }
+    change[0] = '[';
+    out += '\033';
+    out.append(change, len);
+    out += 'm';
+}
+
+// Leading spaces and tabs in text
+std::size_t leading_blanks(std::string_view text) {
+    std::size_t blanks = 0;
+    while (blanks < text.size() && (text[blanks] == ' ' || text[blanks] == '\t')) ++blanks;
+    return blanks;
+}
+
+// A blank looks the same in any colour, bold or italic
+bool blanks_alike(const Style& style) { return !(style.flags & kUnderline) && style.extra.empty(); }
+
+// Tracks what the terminal shows against what the tokens ask for, and
+// writes text with the transitions it needs
+class StyleWriter {
+public:
+    StyleWriter(std::string& out, const Style& current) : out_(out), current_(current) {}
+
+    Style& wanted() { return wanted_; }
+
+    // As after a reset
+    void reset_wanted() {
+        wanted_.flags = 0;
+        wanted_.fg = {};
+        wanted_.extra.clear();
+    }
+
+    // Text that may hold SGR sequences; anything else is written as is
+    void write(std::string_view text) {
+        while (!text.empty()) {
+            std::size_t esc = text.find('\033');
+            write_plain(text.substr(0, esc));
+            if (esc == std::string_view::npos) return;
+            text.remove_prefix(esc);
+
+            if (std::size_t len = sgr_length(text)) {
+                apply_sgr(text.substr(2, len - 3), wanted_);
+                text.remove_prefix(len);
+            } else {
+                write_plain(text.substr(0, 1));
+                text.remove_prefix(1);
+            }
+        }
+    }
+
+    // Back to the default style at the end of the line
+    void finish() {
+        if (!current_.is_default()) out_ += "\033[0m";
+    }
+
+private:
+    void write_plain(std::string_view text) {
+        if (text.empty()) return;
+        if (!(current_ == wanted_)) {
+            if (blanks_alike(current_) && blanks_alike(wanted_)) {
+                std::size_t blanks = leading_blanks(text);
+                out_.append(text.substr(0, blanks));
+                text.remove_prefix(blanks);
+                if (text.empty()) return;
+            }
+            append_transition(current_, wanted_, out_);
+            current_ = wanted_;
+        }
+        out_.append(text);
+    }
+
+    std::string& out_;
+    Style current_;  // What the terminal shows
+    Style wanted_;   // What the next text should be shown in
+};
+
+bool same_colour(std::string_view a, std::string_view b) {
+    // Theme colours ("\033[33m") mostly differ just before the 'm'
+    if (a.size() != b.size()) return false;
+    if (a.size() >= 2 && a[a.size() - 2] != b[b.size() - 2]) return false;
+    return a == b;
+}
+
+// Most styles a StyleTable numbers. A theme has a handful; tokens in
+// colours past the limit go through StyleWriter.
+constexpr std::size_t kMaxTableStyles = 64;
+
+// The styles token colours made only of SGR sequences ask for, numbered,
+// with the transitions between them built once. One per thread, so
+// nothing is parsed twice; entries are never dropped, as the styles
+// point into them. Entry 0 is the default style.
+class StyleTable {
+public:
+    static constexpr std::size_t kNone = static_cast<std::size_t>(-1);
+
+    StyleTable() { entries_.emplace_back(); }
+
+    // Entry for a token's colour and bold; kNone for a colour with
+    // anything but SGR sequences, or when the table is full
+    std::size_t find(std::string_view colour, bool bold) {
+        if (colour.empty() && !bold) return 0;
+        std::size_t id = 0;
+        for (const auto& entry : entries_) {
+            if (entry.bold == bold && same_colour(entry.colour, colour)) return id;
+            ++id;
+        }
+        if (entries_.size() == kMaxTableStyles) return kNone;
+        for (std::string_view rest = colour; !rest.empty();) {
+            std::size_t len = sgr_length(rest);
+            if (len == 0) return kNone;
+            rest.remove_prefix(len);
+        }
+
+        Entry& entry = entries_.emplace_back();
+        entry.colour = colour;
+        entry.bold = bold;
+        // Parsed from the stored copy, which fg points into
+        for (std::string_view rest = entry.colour; !rest.empty();) {
+            std::size_t len = sgr_length(rest);
+            apply_sgr(rest.substr(2, len - 3), entry.style);
+            rest.remove_prefix(len);
+        }
+        if (bold) entry.style.flags |= kBold;
+        entry.blanks_alike = blanks_alike(entry.style);
+        return entries_.size() - 1;
+    }
+
+    const Style& style(std::size_t id) const { return entries_[id].style; }
+
+    bool blanks_alike_between(std::size_t from, std::size_t to) const {
+        return entries_[from].blanks_alike && entries_[to].blanks_alike;
+    }
+
+    // The SGR sequence from one entry's style to another's; empty if
+    // they look the same
+    const std::string& transition(std::size_t from, std::size_t to) {
+        auto& from_to = entries_[to].from;
+        if (from_to.size() <= from) from_to.resize(entries_.size());
+        if (!from_to[from]) {
+            std::string sequence;
+            if (!(style(from) == style(to))) append_transition(style(from), style(to), sequence);
+            from_to[from] = std::move(sequence);
+        }
+        return *from_to[from];
+    }
+
+private:
+    struct Entry {
+        std::string colour;
+        bool bold = false;
+        Style style;
+        bool blanks_alike = true;
+        std::vector<std::optional<std::string>> from;  // Transitions to this entry, by entry
+    };
+
+    std::deque<Entry> entries_;
+};
+
+}  // namespace
+
+void append_styled(const std::vector<SyntaxToken>& tokens, std::string& out) {
+    thread_local StyleTable table;
+    // Tokens in table styles with no SGR in their text, by entry
+    std::size_t current = 0;
+    std::size_t next = 0;
+    for (; next < tokens.size(); ++next) {
+        const auto& token = tokens[next];
+        if (token.text.find('\033') != std::string::npos) break;
+        std::size_t wanted = table.find(token.color, token.bold);
+        if (wanted == StyleTable::kNone) break;
+
+        std::string_view text = token.text;
+        if (wanted != current && !text.empty()) {
+            if (table.blanks_alike_between(current, wanted)) {
+                std::size_t blanks = leading_blanks(text);
+                out.append(text.substr(0, blanks));
+                text.remove_prefix(blanks);
+            }
+            if (!text.empty()) {
+                out += table.transition(current, wanted);
+                current = wanted;
+            }
+        }
+        out.append(text);
+    }
+
+    // The rest through the parser, from what the terminal shows
+    StyleWriter writer(out, table.style(current));
+    for (; next < tokens.size(); ++next) {
+        const auto& token = tokens[next];
+        // Each token starts from the default style, as if after a reset
+        writer.reset_wanted();
+        if (!token.color.empty()) writer.write(token.color);
+        if (token.bold) writer.wanted().flags |= kBold;
+        writer.write(token.text);
+    }
+    writer.finish();
+}
+
+void append_styled_full(const std::vector<SyntaxToken>& tokens, std::string& out) {
+    for (const auto& token : tokens) {
+        if (!token.color.empty()) {
+            out += token.color;
+        }
+        if (token.bold) {
+            out += Color::BOLD;
+        }
+        out += token.text;
+        out += Color::RESET;
+    }
+}
+
+bool minimal_sgr() {
+    static const bool minimal = [] {
+        const char* mode = std::getenv("FASTCAT_SGR");
+        return !(mode && std::strcmp(mode, "full") == 0);
+    }();
+    return minimal;
+}
+
+}  // namespace fastcat